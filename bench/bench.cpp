@@ -0,0 +1,315 @@
+/*!
+ * parse, bind and render benchmarks reporting cpu counters per operation
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/basic_format.h>
+#include <coda/format/dynamic_args.h>
+#include <coda/format/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+
+#ifndef CODA_FORMAT_VERSION
+#define CODA_FORMAT_VERSION "unknown"
+#endif
+
+namespace
+{
+    using coda::bench::perf_counters;
+
+    const char *log_template = "user {0} hit {1,-10} in {2:f2} ms ({3:x})";
+
+    // discards output so print is measured without a device
+    class null_buffer : public std::streambuf
+    {
+       protected:
+        int_type overflow(int_type ch) override
+        {
+            return ch;
+        }
+
+        std::streamsize xsputn(const char *, std::streamsize count) override
+        {
+            return count;
+        }
+    };
+
+    struct scenario {
+        const char *name;
+        std::function<std::size_t()> operation;
+    };
+
+    struct result {
+        const char *name;
+        std::size_t iterations;
+        double nanoseconds;
+        perf_counters::values counts;
+        double coverage;  // the share of the time the counters ran, below 1 when multiplexed
+    };
+
+    // keeps the compiler from removing the measured work
+    volatile std::size_t sink;
+
+    result measure(perf_counters &counters, const scenario &test, std::size_t iterations, std::size_t samples)
+    {
+        std::vector<result> runs;
+
+        for (std::size_t i = 0; i < iterations / 10 + 1; ++i) {
+            sink = sink + test.operation();
+        }
+
+        for (std::size_t sample = 0; sample < samples; ++sample) {
+            std::size_t total = 0;
+
+            const auto start = std::chrono::steady_clock::now();
+            counters.start();
+
+            for (std::size_t i = 0; i < iterations; ++i) {
+                total += test.operation();
+            }
+
+            const auto counts = counters.stop();
+            const auto coverage = counters.coverage();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            sink = sink + total;
+
+            runs.push_back(result{test.name, iterations,
+                                  std::chrono::duration<double, std::nano>(elapsed).count(), counts, coverage});
+        }
+
+        // the median sample is reported, which is stable against scheduling noise
+        std::sort(runs.begin(), runs.end(),
+                  [](const result &first, const result &second) { return first.nanoseconds < second.nanoseconds; });
+
+        return runs[runs.size() / 2];
+    }
+
+    double per_operation(const result &run, std::uint64_t count)
+    {
+        return static_cast<double>(count) / static_cast<double>(run.iterations);
+    }
+
+    // a counter is reported for a run when it is available and the group ran at some point
+    bool counted(const perf_counters &counters, const result &run, perf_counters::counter which)
+    {
+        return counters.available(which) && run.coverage > 0;
+    }
+
+    void write_json(std::ostream &out, const perf_counters &counters, const std::vector<result> &results)
+    {
+        const bool hardware = counters.available(perf_counters::cycles);
+
+        out << "{\n  \"library\": \"coda_format\",\n  \"version\": \"" << CODA_FORMAT_VERSION << "\",\n"
+            << "  \"counters\": " << (hardware ? "true" : "false") << ",\n  \"results\": [";
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto &run = results[i];
+
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << run.name << "\", \"iterations\": " << run.iterations
+                << ", \"ns_per_op\": " << run.nanoseconds / static_cast<double>(run.iterations);
+
+            for (std::size_t which = 0; which < perf_counters::count; ++which) {
+                const auto counter = static_cast<perf_counters::counter>(which);
+
+                out << ", \"" << perf_counters::name(counter) << "_per_op\": ";
+                if (counted(counters, run, counter)) {
+                    out << per_operation(run, run.counts[which]);
+                } else {
+                    out << "null";
+                }
+            }
+
+            out << ", \"ipc\": ";
+            if (counted(counters, run, perf_counters::instructions) && run.counts[perf_counters::cycles] != 0) {
+                out << static_cast<double>(run.counts[perf_counters::instructions]) /
+                           static_cast<double>(run.counts[perf_counters::cycles]);
+            } else {
+                out << "null";
+            }
+
+            out << ", \"counter_coverage\": ";
+            if (hardware) {
+                out << run.coverage;
+            } else {
+                out << "null";
+            }
+
+            out << "}";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+
+    void write_csv(std::ostream &out, const perf_counters &counters, const std::vector<result> &results)
+    {
+        out << "name,iterations,ns_per_op";
+        for (std::size_t which = 0; which < perf_counters::count; ++which) {
+            out << "," << perf_counters::name(static_cast<perf_counters::counter>(which)) << "_per_op";
+        }
+        out << ",ipc,counter_coverage\n";
+
+        // unavailable counters are empty fields
+        for (const auto &run : results) {
+            out << run.name << "," << run.iterations << "," << run.nanoseconds / static_cast<double>(run.iterations);
+
+            for (std::size_t which = 0; which < perf_counters::count; ++which) {
+                out << ",";
+                if (counted(counters, run, static_cast<perf_counters::counter>(which))) {
+                    out << per_operation(run, run.counts[which]);
+                }
+            }
+
+            out << ",";
+            if (counted(counters, run, perf_counters::instructions) && run.counts[perf_counters::cycles] != 0) {
+                out << static_cast<double>(run.counts[perf_counters::instructions]) /
+                           static_cast<double>(run.counts[perf_counters::cycles]);
+            }
+
+            out << ",";
+            if (counters.available(perf_counters::cycles)) {
+                out << run.coverage;
+            }
+            out << "\n";
+        }
+    }
+
+    int usage(const char *program)
+    {
+        std::cerr << "usage: " << program << " [--format json|csv] [--iterations count] [--samples count]"
+                  << std::endl;
+        return 2;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string report = "json";
+    std::size_t iterations = 100000;
+    std::size_t samples = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+
+        const std::string option = argv[i];
+        const std::string value = argv[++i];
+
+        if (option == "--format" && (value == "json" || value == "csv")) {
+            report = value;
+        } else if (option == "--iterations" && std::strtoul(value.c_str(), nullptr, 10) > 0) {
+            iterations = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (option == "--samples" && std::strtoul(value.c_str(), nullptr, 10) > 0) {
+            samples = std::strtoul(value.c_str(), nullptr, 10);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    null_buffer discard;
+    std::ostream null_stream(&discard);
+
+    const std::string source(log_template);
+
+    coda::format bound(source, "bob", "/index", 12.3456, 48879);
+    coda::format reused(source);
+    coda::format dashboard("cpu {0,3}% mem {1,3}% load {2:f2} up {3}", 5, 40, 0.5, "1h");
+    coda::format stamped("{0:t6} request {1}", std::chrono::system_clock::time_point(), 1);
+    const auto start = std::chrono::system_clock::now();
+    coda::format inner("{0}:{1}", "host", 8080);
+    coda::format middle("{0} -> {1,-16}", "client", inner);
+    coda::format nested("[{0}] {1}", middle, "ok");
+    coda::dynamic_args row;
+    std::string buffer;
+    int counter = 0;
+
+    const std::vector<scenario> scenarios = {
+        {"parse", [&]() { return coda::format(source).specifiers(); }},
+        {"bind",
+         [&]() {
+             reused.reset();
+             reused.args("bob", "/index", ++counter * 0.37, counter);
+             return reused.specifiers();
+         }},
+        {"bind_integer",
+         [&]() {
+             reused.arg(3, ++counter);
+             return reused.specifiers();
+         }},
+        {"render_print",
+         [&]() {
+             bound.print(null_stream);
+             return std::size_t(1);
+         }},
+        {"render_str", [&]() { return bound.str().size(); }},
+        {"render_append",
+         [&]() {
+             buffer.clear();
+             bound.append_to(buffer);
+             return buffer.size();
+         }},
+        {"render_nested",
+         [&]() {
+             buffer.clear();
+             nested.append_to(buffer);
+             return buffer.size();
+         }},
+        {"bind_dynamic",
+         [&]() {
+             row.clear();
+             row.push_back("bob").push_back("/index").push_back(++counter * 0.37).push_back(counter);
+             reused.reset();
+             reused.args(row);
+             return reused.specifiers();
+         }},
+        {"bind_time",
+         [&]() {
+             stamped.arg(0, start + std::chrono::microseconds(++counter));
+             return stamped.specifiers();
+         }},
+        {"refresh",
+         [&]() {
+             dashboard.arg(0, ++counter % 100);
+             return dashboard.refresh().size();
+         }},
+        {"format_once",
+         [&]() { return coda::format(source, "bob", "/index", ++counter * 0.37, counter).str().size(); }},
+        {"format_inline",
+         [&]() {
+             coda::basic_format<4, 256> line(source, "bob", "/index", ++counter * 0.37, counter);
+             buffer.clear();
+             line.append_to(buffer);
+             return buffer.size();
+         }},
+    };
+
+    perf_counters counters;
+
+    if (!counters.available(perf_counters::cycles)) {
+        std::cerr << "hardware counters are not available, reporting time only" << std::endl;
+    }
+
+    std::vector<result> results;
+    for (const auto &test : scenarios) {
+        results.push_back(measure(counters, test, iterations, samples));
+    }
+
+    if (report == "csv") {
+        write_csv(std::cout, counters, results);
+    } else {
+        write_json(std::cout, counters, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*!
+ * implementation of the benchmark performance counters
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+namespace coda
+{
+    namespace bench
+    {
+#if defined(__linux__)
+        namespace
+        {
+            const std::uint64_t configs[perf_counters::count] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+                PERF_COUNT_HW_CACHE_MISSES};
+
+            int open_counter(std::uint64_t config, int group)
+            {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = config;
+                attr.disabled = group == -1 ? 1 : 0;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                   PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                return static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+            }
+        }
+
+        perf_counters::perf_counters() : fds_(), leader_(-1), coverage_(0)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                fds_[i] = open_counter(configs[i], leader_);
+                if (leader_ == -1) {
+                    leader_ = fds_[i];
+                }
+            }
+        }
+
+        perf_counters::~perf_counters()
+        {
+            for (const auto fd : fds_) {
+                if (fd != -1) {
+                    ::close(fd);
+                }
+            }
+        }
+
+        bool perf_counters::available(counter which) const
+        {
+            return fds_[which] != -1;
+        }
+
+        void perf_counters::start()
+        {
+            if (leader_ == -1) {
+                return;
+            }
+
+            ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        perf_counters::values perf_counters::stop()
+        {
+            values result = {};
+            coverage_ = 0;
+
+            if (leader_ == -1) {
+                return result;
+            }
+
+            ::ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+            // the group is read as its size, the time enabled and running, then a value and id for each counter
+            std::uint64_t buffer[3 + count * 2] = {};
+            if (::read(leader_, buffer, sizeof(buffer)) <= 0) {
+                return result;
+            }
+
+            const auto enabled = buffer[1];
+            const auto running = buffer[2];
+
+            // a group never scheduled on the cpu counted nothing, so there is nothing to report
+            if (enabled == 0 || running == 0) {
+                return result;
+            }
+
+            // the kernel multiplexes the group when it shares the counters, so the
+            // counts cover part of the time and are scaled up to all of it
+            coverage_ = static_cast<double>(running) / static_cast<double>(enabled);
+
+            std::uint64_t ids[count] = {};
+            for (std::size_t i = 0; i < count; ++i) {
+                if (fds_[i] != -1) {
+                    ::ioctl(fds_[i], PERF_EVENT_IOC_ID, &ids[i]);
+                }
+            }
+
+            for (std::uint64_t entry = 0; entry < buffer[0] && entry < count; ++entry) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (fds_[i] != -1 && ids[i] == buffer[4 + entry * 2]) {
+                        result[i] = running == enabled ? buffer[3 + entry * 2]
+                                                       : static_cast<std::uint64_t>(
+                                                             static_cast<double>(buffer[3 + entry * 2]) / coverage_);
+                    }
+                }
+            }
+
+            return result;
+        }
+#else
+        perf_counters::perf_counters() : fds_(), leader_(-1), coverage_(0)
+        {
+            fds_.fill(-1);
+        }
+
+        perf_counters::~perf_counters()
+        {
+        }
+
+        bool perf_counters::available(counter) const
+        {
+            return false;
+        }
+
+        void perf_counters::start()
+        {
+        }
+
+        perf_counters::values perf_counters::stop()
+        {
+            return values();
+        }
+#endif
+
+        double perf_counters::coverage() const
+        {
+            return coverage_;
+        }
+
+        const char *perf_counters::name(counter which)
+        {
+            static const char *names[count] = {"cycles", "instructions", "branch_misses", "cache_misses"};
+            return names[which];
+        }
+    }
+}
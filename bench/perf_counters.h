@@ -0,0 +1,73 @@
+/*!
+ * hardware performance counters for the benchmarks
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#ifndef CODA_FORMAT_BENCH_PERF_COUNTERS_H
+#define CODA_FORMAT_BENCH_PERF_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace coda
+{
+    namespace bench
+    {
+        /*!
+         * a group of cpu counters for the calling thread, read through linux
+         * perf_event_open. a counter the kernel does not permit or the cpu
+         * does not have is reported as unavailable, and every counter is
+         * unavailable on other systems.
+         */
+        class perf_counters
+        {
+           public:
+            enum counter : std::size_t { cycles, instructions, branch_misses, cache_misses, count };
+
+            typedef std::array<std::uint64_t, count> values;
+
+            perf_counters();
+
+            perf_counters(const perf_counters &other) = delete;
+            perf_counters &operator=(const perf_counters &rhs) = delete;
+
+            ~perf_counters();
+
+            /*!
+             * @return true if the counter can be read
+             */
+            bool available(counter which) const;
+
+            /*!
+             * resets and starts every available counter
+             */
+            void start();
+
+            /*!
+             * stops the counters
+             * @return the counts since start, zero for unavailable counters,
+             * scaled up to the whole time when the group was multiplexed
+             */
+            values stop();
+
+            /*!
+             * @return the share of the time of the last stop the counters were
+             * running, 1 when they ran throughout and 0 when they never ran
+             */
+            double coverage() const;
+
+            /*!
+             * @return the name of a counter as used in reports
+             */
+            static const char *name(counter which);
+
+           private:
+            std::array<int, count> fds_;  // the counter file descriptors, -1 when unavailable
+            int leader_;                   // the first available counter, which controls the group
+            double coverage_;              // the share of the last run the group counted
+        };
+    }
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include <coda/format/format.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <iterator>
 #include <stdexcept>
@@ -31,6 +32,17 @@ int main()
         input.resize(max_input_size);
     }
 
+    // the non-throwing validation must agree with the constructor
+    bool constructed = true;
+    try {
+        coda::format probe(input);
+    } catch (const std::invalid_argument &) {
+        constructed = false;
+    }
+    if (constructed != static_cast<bool>(coda::format::validate(input))) {
+        std::abort();
+    }
+
     try {
         coda::format parsed(input);
 
@@ -0,0 +1,79 @@
+#include <coda/format/format.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "counters.h"
+
+// Deterministic complexity harness: parses and renders one input while the
+// library counts the characters it scans or copies and the comparisons it
+// makes. Work above a linear budget in input bytes and specifiers aborts, so
+// AFL++ records the input as a crash.
+
+namespace
+{
+    constexpr std::size_t max_input_size = 1 << 20;
+
+    // operations allowed per input byte, per specifier, and for any input
+    constexpr std::uint64_t per_byte = 64;
+    constexpr std::uint64_t per_specifier = 512;
+    constexpr std::uint64_t fixed_cost = 1024;
+
+    std::uint64_t budget(std::size_t bytes, std::size_t specifiers)
+    {
+        return per_byte * bytes + per_specifier * specifiers + fixed_cost;
+    }
+
+    double ratio(std::uint64_t operations, std::size_t count)
+    {
+        return count == 0 ? 0.0 : static_cast<double>(operations) / static_cast<double>(count);
+    }
+}
+
+int main()
+{
+    std::string input((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+    if (input.size() > max_input_size) {
+        input.resize(max_input_size);
+    }
+
+    auto &counters = coda::detail::counters;
+    std::size_t specifiers = 0;
+
+    try {
+        coda::format parsed(input);
+        specifiers = parsed.specifiers();
+
+        for (std::size_t index = 0; index < specifiers; ++index) {
+            parsed.args(123.125);
+        }
+
+        const auto rendered = parsed.str();
+        (void)rendered;
+    } catch (const std::invalid_argument &) {
+        // Invalid format strings are expected parser outcomes; the work spent rejecting them still counts.
+    }
+
+    const auto limit = budget(input.size(), specifiers);
+
+    std::printf("bytes=%zu specifiers=%zu parse_ops=%llu render_ops=%llu "
+                "parse_per_byte=%.2f render_per_byte=%.2f parse_per_specifier=%.2f render_per_specifier=%.2f "
+                "budget=%llu\n",
+                input.size(), specifiers, static_cast<unsigned long long>(counters.parse),
+                static_cast<unsigned long long>(counters.render), ratio(counters.parse, input.size()),
+                ratio(counters.render, input.size()), ratio(counters.parse, specifiers),
+                ratio(counters.render, specifiers), static_cast<unsigned long long>(limit));
+
+    if (counters.parse > limit || counters.render > limit) {
+        std::fprintf(stderr, "work exceeds the linear budget\n");
+        std::abort();
+    }
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*!
+ * a format keeping its storage inside the object
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#ifndef CODA_FORMAT_BASIC_FORMAT_H
+#define CODA_FORMAT_BASIC_FORMAT_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <coda/format/format.h>
+
+namespace coda
+{
+    namespace detail
+    {
+        /*!
+         * a memory resource handing out blocks of a fixed buffer, and of the
+         * heap once the buffer is full. a freed block is merged with freed
+         * blocks next to it, and space at the end of the buffer is given back
+         * once every block above it is freed, so blocks freed in any order
+         * are reused. the whole buffer is reused once every block in it is
+         * freed.
+         */
+        class inline_resource : public std::pmr::memory_resource
+        {
+           public:
+            inline_resource(void *buffer, std::size_t size);
+            inline_resource(const inline_resource &other) = delete;
+            inline_resource &operator=(const inline_resource &rhs) = delete;
+
+            /*!
+             * @return the number of bytes handed out from the heap and not freed
+             */
+            std::size_t overflow() const;
+
+           protected:
+            void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+            void do_deallocate(void *block, std::size_t bytes, std::size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+           private:
+            // freed space below the end of the buffer in use, not yet given back
+            struct range {
+                std::size_t start;
+                std::size_t end;
+            };
+
+            // the freed ranges kept, a block freed when they are all taken is only reused with the buffer
+            static constexpr std::size_t max_ranges = 4;
+
+            void release(std::size_t start, std::size_t end);
+
+            char *buffer_;               // the inline storage
+            std::size_t size_;           // the size of the buffer
+            std::size_t used_;           // the end of the last block in the buffer
+            std::size_t blocks_;         // the blocks in the buffer not freed
+            std::size_t overflow_;       // the heap bytes not freed
+            range ranges_[max_ranges];   // the freed ranges, sorted by start
+            std::size_t range_count_;    // the freed ranges in use
+        };
+
+        // the buffer and its resource, a base so they are built before the format using them
+        template <std::size_t Size>
+        struct inline_arena {
+            alignas(std::max_align_t) char buffer[Size];
+            inline_resource resource;
+
+            inline_arena() : resource(buffer, Size)
+            {
+            }
+
+            std::pmr::memory_resource *memory()
+            {
+                return &resource;
+            }
+        };
+    }
+
+    /*!
+     * a format keeping its format string, specifiers, render program and
+     * replacements inside the object, so a short lived format on the stack
+     * does not touch the heap:
+     *
+     *     coda::basic_format<4, 256> line("{0}: {1}", key, value);
+     *     line.append_to(out);
+     *
+     * InlineSpecifiers sizes the specifier and program storage and
+     * InlineBytes the strings. a format needing more falls back to the heap
+     * for the rest, so any format string works. copying or moving to a
+     * plain format copies to the heap.
+     *
+     * a replacement that grows keeps its smaller buffers until the space
+     * above them is freed, so a string growing by doubling to n bytes uses
+     * about 2n of InlineBytes while it is built. size InlineBytes for twice
+     * the longest replacement to keep rebinding off the heap.
+     */
+    template <std::size_t InlineSpecifiers = 8, std::size_t InlineBytes = 512>
+    class basic_format : private detail::inline_arena<format::inline_size(InlineSpecifiers, InlineBytes)>,
+                         public format
+    {
+        typedef detail::inline_arena<format::inline_size(InlineSpecifiers, InlineBytes)> arena;
+
+       public:
+        /*!
+         * @throws invalid_argument with the validate error and offset if the format string is invalid
+         */
+        basic_format(std::string_view str) : arena(), format(str, this->memory())
+        {
+        }
+
+        template <typename T, typename... Args>
+        basic_format(std::string_view str, T &&value, Args &&... argv) : basic_format(str)
+        {
+            args(std::forward<T>(value), std::forward<Args>(argv)...);
+        }
+
+        basic_format(const basic_format &other) : arena(), format(other, this->memory())
+        {
+        }
+
+        basic_format(const format &other) : arena(), format(other, this->memory())
+        {
+        }
+
+        basic_format &operator=(const basic_format &rhs)
+        {
+            format::operator=(rhs);
+            return *this;
+        }
+
+        basic_format &operator=(const format &rhs)
+        {
+            format::operator=(rhs);
+            return *this;
+        }
+
+        /*!
+         * @return the number of bytes the format has taken from the heap
+         */
+        std::size_t overflow() const
+        {
+            return this->resource.overflow();
+        }
+    };
+
+    typedef basic_format<> small_format;
+}
+
+#endif
@@ -0,0 +1,264 @@
+/*!
+ * deferred binary capture of formatted records
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#ifndef CODA_FORMAT_CAPTURE_H
+#define CODA_FORMAT_CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace coda
+{
+    /*!
+     * layout shared by the capture writer and the offline decoder.
+     *
+     * a capture file is a fixed header followed by a stream of records. a
+     * template is defined once per file before the first record that uses it;
+     * each record holds the template id and the raw bytes of its arguments.
+     * all values are stored in host byte order, which the header identifies.
+     */
+    namespace capture
+    {
+        static const char magic[8] = {'C', 'O', 'D', 'A', 'C', 'A', 'P', 'T'};
+        static const std::uint32_t version = 1;
+        static const std::uint32_t byte_order = 0x01020304;
+
+        struct header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint64_t capacity;  // bytes available after the header
+            std::uint64_t used;      // bytes of complete records after the header
+        };
+
+        // the kind of entry following the header
+        enum entry : std::uint8_t { define_entry = 1, record_entry = 2 };
+
+        // the argument type tags of a record
+        enum tag : std::uint8_t {
+            boolean_tag = 1,
+            character_tag,
+            int16_tag,
+            uint16_tag,
+            int32_tag,
+            uint32_tag,
+            int64_tag,
+            uint64_tag,
+            float64_tag,
+            string_tag
+        };
+
+        /*!
+         * @return the tag a built-in value is stored with
+         */
+        template <typename T>
+        constexpr tag tag_of()
+        {
+            static_assert(std::is_arithmetic<T>::value, "only built-in types can be captured");
+            static_assert(sizeof(T) <= 8 && !std::is_same<T, long double>::value, "unsupported capture type");
+
+            if (std::is_same<T, bool>::value) {
+                return boolean_tag;
+            }
+            if (std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                std::is_same<T, unsigned char>::value) {
+                return character_tag;
+            }
+            if (std::is_floating_point<T>::value) {
+                return float64_tag;
+            }
+            if (sizeof(T) == 2) {
+                return std::is_signed<T>::value ? int16_tag : uint16_tag;
+            }
+            if (sizeof(T) == 4) {
+                return std::is_signed<T>::value ? int32_tag : uint32_tag;
+            }
+            return std::is_signed<T>::value ? int64_tag : uint64_tag;
+        }
+    }
+
+    /*!
+     * writes templates and raw argument values to a memory mapped file
+     * instead of rendering text. the capture_reader rebuilds the text later.
+     * a writer is not thread safe; use one per producing thread.
+     */
+    class capture_writer
+    {
+       public:
+        /*!
+         * creates or truncates the file at path with room for capacity bytes of records
+         * @throws runtime_error if the file cannot be created or mapped
+         */
+        capture_writer(const std::string &path, std::size_t capacity);
+
+        capture_writer(const capture_writer &other) = delete;
+        capture_writer &operator=(const capture_writer &rhs) = delete;
+
+        /*!
+         * unmaps the file and trims it to the bytes used
+         */
+        ~capture_writer();
+
+        /*!
+         * stores a format string in the file dictionary
+         * @return the template id used to record arguments
+         * @throws invalid_argument if the format string is invalid
+         * @throws length_error if the file is full
+         */
+        std::uint32_t define(const std::string &str);
+
+        /*!
+         * records the arguments for a template without formatting them
+         * @throws invalid_argument if the id is unknown or there is no specifier for an argument
+         * @throws length_error if the file is full
+         */
+        template <typename... Args>
+        void record(std::uint32_t id, const Args &... argv)
+        {
+            static_assert(sizeof...(Args) <= 255, "too many arguments for a capture record");
+
+            if (id >= arguments_.size()) {
+                throw std::invalid_argument("unknown capture template");
+            }
+
+            if (sizeof...(Args) > arguments_[id]) {
+                throw std::invalid_argument("no specifier for argument");
+            }
+
+            char *pos = reserve(sizeof(std::uint8_t) + sizeof(std::uint32_t) + sizeof(std::uint8_t) + encoded_size(argv...));
+
+            pos = put(pos, static_cast<std::uint8_t>(capture::record_entry));
+            pos = put(pos, id);
+            pos = put(pos, static_cast<std::uint8_t>(sizeof...(Args)));
+            encode(pos, argv...);
+
+            commit();
+        }
+
+        /*!
+         * @return the number of record bytes written
+         */
+        std::size_t size() const;
+
+        /*!
+         * writes the mapped pages back to the file
+         */
+        void flush();
+
+       private:
+        template <typename T>
+        static char *put(char *pos, const T &value)
+        {
+            std::memcpy(pos, &value, sizeof(T));
+            return pos + sizeof(T);
+        }
+
+        template <typename T>
+        static std::size_t encoded_length(const T &)
+        {
+            constexpr auto tag = capture::tag_of<T>();
+            if (tag == capture::boolean_tag || tag == capture::character_tag) {
+                return 2;
+            }
+            if (tag == capture::float64_tag) {
+                return 1 + sizeof(double);
+            }
+            return 1 + sizeof(T);
+        }
+
+        static std::size_t encoded_length(const std::string &value)
+        {
+            return 1 + sizeof(std::uint32_t) + value.size();
+        }
+
+        static std::size_t encoded_length(const char *value)
+        {
+            return 1 + sizeof(std::uint32_t) + std::strlen(value);
+        }
+
+        static std::size_t encoded_size()
+        {
+            return 0;
+        }
+
+        template <typename T, typename... Args>
+        static std::size_t encoded_size(const T &value, const Args &... argv)
+        {
+            return encoded_length(value) + encoded_size(argv...);
+        }
+
+        template <typename T>
+        static char *encode_value(char *pos, const T &value)
+        {
+            constexpr auto tag = capture::tag_of<T>();
+            pos = put(pos, static_cast<std::uint8_t>(tag));
+
+            if (tag == capture::boolean_tag || tag == capture::character_tag) {
+                return put(pos, static_cast<char>(value));
+            }
+            if (tag == capture::float64_tag) {
+                return put(pos, static_cast<double>(value));
+            }
+            return put(pos, value);
+        }
+
+        static char *encode_string(char *pos, const char *value, std::size_t length)
+        {
+            pos = put(pos, static_cast<std::uint8_t>(capture::string_tag));
+            pos = put(pos, static_cast<std::uint32_t>(length));
+            std::memcpy(pos, value, length);
+            return pos + length;
+        }
+
+        static char *encode_value(char *pos, const std::string &value)
+        {
+            return encode_string(pos, value.data(), value.size());
+        }
+
+        static char *encode_value(char *pos, const char *value)
+        {
+            return encode_string(pos, value, std::strlen(value));
+        }
+
+        static void encode(char *)
+        {
+        }
+
+        template <typename T, typename... Args>
+        static void encode(char *pos, const T &value, const Args &... argv)
+        {
+            encode(encode_value(pos, value), argv...);
+        }
+
+        /*!
+         * @return the position to write the next length bytes
+         * @throws length_error if the file is full
+         */
+        char *reserve(std::size_t length);
+
+        /*!
+         * publishes the reserved record by storing the used length in the header
+         */
+        void commit();
+
+        /*!
+         * @return the used length in the mapped header
+         */
+        std::uint64_t *used_field() const;
+
+        int fd_;                               // the capture file
+        char *map_;                            // the mapped header and records
+        std::size_t capacity_;                 // the record capacity
+        std::size_t pending_;                  // the end of the reserved record
+        std::vector<std::size_t> arguments_;  // argument counts by template id
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*!
+ * precompiled catalogs of format templates
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#ifndef CODA_FORMAT_CATALOG_H
+#define CODA_FORMAT_CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <coda/format/format.h>
+
+namespace coda
+{
+    /*!
+     * layout shared by the catalog writer and reader.
+     *
+     * a catalog file is a fixed header, the compiled templates, and an index
+     * of template ids to their position in the file. a compiled template
+     * holds the format string, literal pool, decoded specifiers, render
+     * program and name table, so loading it does not parse the format string.
+     * all values are stored in host byte order, which the header identifies.
+     */
+    namespace catalog
+    {
+        static const char magic[8] = {'C', 'O', 'D', 'A', 'C', 'A', 'T', 'L'};
+        static const std::uint32_t version = 4;
+        static const std::uint32_t byte_order = 0x01020304;
+
+        struct header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint64_t count;   // the number of templates
+            std::uint64_t index;   // the file offset of the index
+            std::uint64_t length;  // the file length
+        };
+
+        // an index entry for a template id
+        struct entry {
+            std::uint64_t offset;  // the file offset of the compiled template
+            std::uint64_t length;  // the compiled template length
+        };
+    }
+
+    /*!
+     * parses format strings once, for instance at build time, and writes
+     * them to a catalog file
+     */
+    class catalog_writer
+    {
+       public:
+        catalog_writer();
+
+        /*!
+         * parses a format string and adds it to the catalog
+         * @return the template id
+         * @throws invalid_argument if the format string is invalid
+         */
+        std::uint32_t add(const std::string &str);
+
+        /*!
+         * @return the number of templates
+         */
+        std::size_t size() const;
+
+        /*!
+         * writes the catalog file at path
+         * @throws runtime_error if the file cannot be written
+         */
+        void write(const std::string &path) const;
+
+       private:
+        std::string templates_;                // the compiled templates
+        std::vector<catalog::entry> index_;  // the template positions
+    };
+
+    /*!
+     * maps a catalog file. opening only checks the header, and each template
+     * is validated when it is loaded, so the cost does not grow with the
+     * number of templates in the file.
+     */
+    class catalog_reader
+    {
+       public:
+        /*!
+         * maps the catalog file at path
+         * @throws runtime_error if the file cannot be opened
+         * @throws invalid_argument if the file is not a compatible catalog file
+         */
+        explicit catalog_reader(const std::string &path);
+
+        catalog_reader(const catalog_reader &other) = delete;
+        catalog_reader &operator=(const catalog_reader &rhs) = delete;
+
+        ~catalog_reader();
+
+        /*!
+         * @return the number of templates
+         */
+        std::size_t size() const;
+
+        /*!
+         * @return the template for an id, ready for arguments
+         * @throws invalid_argument if the id is unknown or the template is corrupt
+         */
+        format get(std::uint32_t id) const;
+
+       private:
+        const char *map_;     // the mapped file
+        std::size_t length_;  // the mapped length
+        std::size_t count_;   // the number of templates
+        std::size_t index_;   // the offset of the index
+    };
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*!
+ * offline decoding of captured records
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#ifndef CODA_FORMAT_DECODER_H
+#define CODA_FORMAT_DECODER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <coda/format/capture.h>
+#include <coda/format/format.h>
+
+namespace coda
+{
+    /*!
+     * reads a file written by a capture_writer and rebuilds the text each
+     * record would have produced with coda::format
+     */
+    class capture_reader
+    {
+       public:
+        /*!
+         * maps the capture file at path
+         * @throws runtime_error if the file cannot be opened
+         * @throws invalid_argument if the file is not a compatible capture file
+         */
+        explicit capture_reader(const std::string &path);
+
+        capture_reader(const capture_reader &other) = delete;
+        capture_reader &operator=(const capture_reader &rhs) = delete;
+
+        ~capture_reader();
+
+        /*!
+         * renders the next record, reading any template definitions before it
+         * @return false when there are no more records
+         * @throws invalid_argument if the record is corrupt
+         */
+        bool next(std::string &out);
+
+       private:
+        /*!
+         * @return the next length bytes of the record stream
+         * @throws invalid_argument if the stream is truncated
+         */
+        const char *read(std::size_t length);
+
+        template <typename T>
+        T read_value();
+
+        void decode_argument(format &record);
+
+        const char *map_;               // the mapped file
+        std::size_t length_;            // the mapped length
+        std::size_t end_;               // the end of the records
+        std::size_t pos_;               // the current read position
+        std::vector<format> templates_;  // the template dictionary
+    };
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*!
+ * a runtime sized list of format arguments
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#ifndef CODA_FORMAT_DYNAMIC_ARGS_H
+#define CODA_FORMAT_DYNAMIC_ARGS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <coda/format/capture.h>
+#include <coda/format/format.h>
+
+namespace coda
+{
+    /*!
+     * arguments whose count is only known at runtime, such as the fields of
+     * a database row, bound to a format in one call:
+     *
+     *     dynamic_args row;
+     *     for (const auto &field : fields) {
+     *         row.push_back(field.value);
+     *     }
+     *     f.args(row);
+     *
+     * values are stored as a type tag and an eight byte slot each, with
+     * string contents copied to one side buffer, so adding a value does not
+     * allocate once the store has grown to its largest size. clear keeps
+     * the capacity for the next list.
+     */
+    class dynamic_args
+    {
+       public:
+        dynamic_args();
+
+        /*!
+         * reserves room for count values holding string_bytes of string contents
+         */
+        void reserve(std::size_t count, std::size_t string_bytes = 0);
+
+        /*!
+         * adds a built-in value or a string, which is copied
+         * @throws invalid_argument if the string is a null pointer
+         */
+        template <typename T>
+        dynamic_args &push_back(const T &value)
+        {
+            if constexpr (detail::is_string<T>::value) {
+                if constexpr (std::is_pointer<T>::value) {
+                    if (value == nullptr) {
+                        throw std::invalid_argument("null string argument");
+                    }
+                }
+
+                const std::string_view str(value);
+
+                const std::size_t limit = std::numeric_limits<std::uint32_t>::max();
+                if (str.size() > limit || strings_.size() > limit - str.size()) {
+                    throw std::length_error("dynamic argument strings too long");
+                }
+
+                const auto offset = strings_.size();
+                strings_.append(str.data(), str.size());
+
+                try {
+                    // the offset and length share the slot
+                    add(capture::string_tag, static_cast<std::uint64_t>(offset) << 32 | str.size());
+                } catch (...) {
+                    strings_.resize(offset);
+                    throw;
+                }
+            } else {
+                static_assert(std::is_arithmetic<T>::value, "only built-in types and strings can be stored");
+
+                std::uint64_t bits = 0;
+
+                if constexpr (std::is_floating_point<T>::value) {
+                    const double widened = value;
+                    std::memcpy(&bits, &widened, sizeof(bits));
+                } else {
+                    bits = static_cast<std::uint64_t>(value);
+                }
+
+                add(capture::tag_of<T>(), bits);
+            }
+
+            return *this;
+        }
+
+        /*!
+         * @return the number of values
+         */
+        std::size_t size() const;
+
+        bool empty() const;
+
+        /*!
+         * removes every value, keeping the capacity
+         */
+        void clear();
+
+       private:
+        friend class format;
+
+        /*!
+         * adds a tag and its value, or neither if there is no memory
+         */
+        void add(capture::tag tag, std::uint64_t bits);
+
+        std::vector<capture::tag> tags_;     // the type of each value
+        std::vector<std::uint64_t> values_;  // the value bits, or the string offset and length
+        std::string strings_;                // the string contents
+    };
+}
+
+#endif
@@ -6,16 +6,237 @@
 #ifndef CODA_FORMAT_H
 #define CODA_FORMAT_H
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
-#include <list>
+#include <ios>
+#include <iterator>
+#include <memory_resource>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace coda
 {
+    /*!
+     * the output buffer a formatter appends a rendered value to, either the
+     * allocator aware string of a format or a plain string
+     */
+    class format_sink
+    {
+       public:
+        explicit format_sink(std::pmr::string &out) : resource_out_(&out), out_(nullptr)
+        {
+        }
+
+        explicit format_sink(std::string &out) : resource_out_(nullptr), out_(&out)
+        {
+        }
+
+        void append(const char *value, std::size_t length)
+        {
+            if (resource_out_ != nullptr) {
+                resource_out_->append(value, length);
+            } else {
+                out_->append(value, length);
+            }
+        }
+
+        void append(std::string_view value)
+        {
+            append(value.data(), value.size());
+        }
+
+        void push_back(char value)
+        {
+            if (resource_out_ != nullptr) {
+                resource_out_->push_back(value);
+            } else {
+                out_->push_back(value);
+            }
+        }
+
+        /*!
+         * @return the number of characters written so far
+         */
+        std::size_t size() const
+        {
+            return resource_out_ != nullptr ? resource_out_->size() : out_->size();
+        }
+
+       private:
+        std::pmr::string *resource_out_;  // the output of a format, or null
+        std::string *out_;                // a plain output, or null
+    };
+
+    /*!
+     * customization point to render a type without iostreams. a
+     * specialization provides a format member appending the value to a sink:
+     *
+     *     void format(const T &value, format_sink &out) const;
+     *
+     * and optionally a parse member receiving the type and argument of the
+     * specifier ('\0' and empty when absent) before the value is formatted:
+     *
+     *     void parse(char type, std::string_view argument);
+     *
+     * a parse member taking a const std::string & still works, at the cost
+     * of building the string on every bind. a specialization is preferred
+     * over operator<<. the specifier width, alignment and fill are applied to
+     * the result.
+     */
+    template <typename T, typename Enable = void>
+    struct formatter {
+    };
+
+    namespace detail
+    {
+        template <typename T, typename = void>
+        struct has_formatter : std::false_type {
+        };
+
+        template <typename T>
+        struct has_formatter<T, decltype(std::declval<const formatter<T> &>().format(std::declval<const T &>(),
+                                                                                         std::declval<format_sink &>()),
+                                         void())> : std::true_type {
+        };
+
+        template <typename T, typename = void>
+        struct has_formatter_parse : std::false_type {
+        };
+
+        template <typename T>
+        struct has_formatter_parse<
+            T, decltype(std::declval<formatter<T> &>().parse(char(), std::declval<std::string_view>()), void())>
+            : std::true_type {
+        };
+
+        // a parse member taking a std::string, from before it took a view
+        template <typename T, typename = void>
+        struct has_formatter_string_parse : std::false_type {
+        };
+
+        template <typename T>
+        struct has_formatter_string_parse<
+            T, decltype(std::declval<formatter<T> &>().parse(char(), std::declval<const std::string &>()), void())>
+            : std::true_type {
+        };
+
+        // character types render as a character, not a number
+        template <typename T>
+        struct is_character
+            : std::integral_constant<bool, std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                                               std::is_same<T, unsigned char>::value> {
+        };
+
+        // integer types with a direct conversion
+        template <typename T>
+        struct is_integer
+            : std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                               !is_character<T>::value && !std::is_same<T, wchar_t>::value &&
+                                               !std::is_same<T, char16_t>::value &&
+                                               !std::is_same<T, char32_t>::value> {
+        };
+
+        // string types with a direct conversion
+        template <typename T>
+        struct is_string
+            : std::integral_constant<bool, std::is_same<T, std::string>::value ||
+                                               std::is_same<T, std::string_view>::value ||
+                                               std::is_same<T, const char *>::value || std::is_same<T, char *>::value ||
+                                               (std::is_array<T>::value &&
+                                                std::is_same<typename std::remove_cv<typename std::remove_extent<
+                                                                 T>::type>::type,
+                                                             char>::value)> {
+        };
+    }
+
+    /*!
+     * a range argument, see join
+     */
+    template <typename Range>
+    struct joined {
+        const Range &range;
+        std::string_view separator;
+    };
+
+    /*!
+     * wraps a range as one argument. every element is rendered with the
+     * specifier of the placeholder, including its width, and the elements
+     * are separated by separator:
+     *
+     *     format("[{0,4:x}]", join(values, " "));
+     *
+     * the range must outlive the binding.
+     */
+    template <typename Range>
+    joined<Range> join(const Range &range, std::string_view separator = ", ")
+    {
+        return joined<Range>{range, separator};
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        struct is_joined : std::false_type {
+        };
+
+        template <typename Range>
+        struct is_joined<joined<Range>> : std::true_type {
+        };
+
+        // ranges with their elements in one block of memory
+        template <typename T, typename = void>
+        struct is_contiguous : std::false_type {
+        };
+
+        template <typename T>
+        struct is_contiguous<T, decltype(std::data(std::declval<const T &>()), std::size(std::declval<const T &>()),
+                                         void())> : std::true_type {
+        };
+
+        template <typename T>
+        struct is_byte
+            : std::integral_constant<bool, is_character<T>::value || std::is_same<T, std::byte>::value> {
+        };
+
+        // points in time of the system clock, rendered as ISO 8601
+        template <typename T>
+        struct is_time_point : std::false_type {
+        };
+
+        template <typename Duration>
+        struct is_time_point<std::chrono::time_point<std::chrono::system_clock, Duration>> : std::true_type {
+        };
+
+        // contiguous byte buffers, rendered as a hex dump
+        template <typename T, typename = void>
+        struct is_byte_range : std::false_type {
+        };
+
+        template <typename T>
+        struct is_byte_range<T, typename std::enable_if<is_contiguous<T>::value && !is_string<T>::value>::type>
+            : is_byte<typename std::remove_cv<
+                  typename std::remove_pointer<decltype(std::data(std::declval<const T &>()))>::type>::type> {
+        };
+
+        // arrays of signed or unsigned char, which operator<< writes as strings
+        template <typename T>
+        struct is_character_array
+            : std::integral_constant<bool, std::is_array<T>::value &&
+                                               is_character<typename std::remove_cv<
+                                                   typename std::remove_extent<T>::type>::type>::value> {
+        };
+    }
+
+    class dynamic_args;
+
     /*!
      * class to handle printf style formating using a format string containing specifiers that
      * get replaced with argument values
@@ -27,27 +248,78 @@ namespace coda
 
         /*!
          * adds an argument for the next specifier
-         * singlular form of the varaidic override
+         * singlular form of the varaidic override. a format argument is
+         * kept by reference and rendered in place when this format is, so it
+         * must outlive the rendering and not be moved or assigned while bound;
+         * a temporary format is copied instead.
          * @throws invalid_argument if there is no specifier for the argument
          */
-        template <typename T>
-        format &args(const T &value)
+        template <typename T, typename = typename std::enable_if<
+                                  !std::is_same<typename std::decay<T>::type, dynamic_args>::value>::type>
+        format &args(T &&value)
         {
             // check if there isn't a specifier
-            if (currentSpecifier_ == specifiers_.end()) {
+            if (cursor_ == arguments_) {
+                throw std::invalid_argument("no specifier for argument");
+            }
+
+            bind_argument(cursor_, value);
+
+            if constexpr (is_temporary_format<T>) {
+                detach(cursor_);
+            }
+
+            ++cursor_;  // advance once the argument is bound
+
+            return *this;
+        }
+
+        /*!
+         * adds every stored argument for the next specifiers, in one call.
+         * if any argument fails, the format is left as it was before the call.
+         * @throws invalid_argument if there are more arguments than unbound
+         * specifiers, or if an argument does not suit its specifier
+         */
+        format &args(const dynamic_args &values);
+
+        /*!
+         * binds an argument to every specifier with the given name
+         * @throws invalid_argument if there is no specifier with the name
+         */
+        template <typename T>
+        format &arg(std::string_view name, T &&value)
+        {
+            const auto index = find_argument(name);
+
+            if (index == npos) {
                 throw std::invalid_argument("no specifier for argument");
             }
 
-            specifier &arg = *currentSpecifier_++;  // get specifier and advance
+            bind_argument(index, value);
 
-            // get the argument value as a string
-            std::ostringstream buf;
+            if constexpr (is_temporary_format<T>) {
+                detach(index);
+            }
+
+            return *this;
+        }
+
+        /*!
+         * binds or rebinds the argument with the given index
+         * @throws invalid_argument if there is no specifier for the index
+         */
+        template <typename T>
+        format &arg(std::size_t index, T &&value)
+        {
+            if (index >= arguments_) {
+                throw std::invalid_argument("no specifier for argument");
+            }
 
-            begin_manip(buf, arg);  // set stream flags for arg
-            buf << value;           // append value
-            end_manip(buf, arg);    // cleanup stream from arg
+            bind_argument(index, value);
 
-            arg.replacement = buf.str();
+            if constexpr (is_temporary_format<T>) {
+                detach(index);
+            }
 
             return *this;
         }
@@ -56,11 +328,11 @@ namespace coda
          * adds a list of arguments to replace specifiers
          * @throws invalid_argument if there is no specifier for an argument
          */
-        template <typename T, typename... Args>
-        format &args(const T &value, const Args &... argv)
+        template <typename T, typename U, typename... Args>
+        format &args(T &&value, U &&next, Args &&... argv)
         {
-            args(value);    // add argument
-            args(argv...);  // add remaining arguments (recursive)
+            args(std::forward<T>(value));                              // add argument
+            args(std::forward<U>(next), std::forward<Args>(argv)...);  // add remaining arguments (recursive)
             return *this;
         }
 
@@ -71,21 +343,105 @@ namespace coda
          * @throws invalid_argument if there isn't a specifier for an argument
          */
         template <typename T, typename... Args>
-        format(const std::string &str, const T &value, const Args &... argv) : format(str)
+        format(const std::string &str, T &&value, Args &&... argv) : format(str)
         {
-            args(value);    // add argument
-            args(argv...);  // add remaining arguments
+            args(std::forward<T>(value));       // add argument
+            args(std::forward<Args>(argv)...);  // add remaining arguments
         }
 
         /*!
          * single form of the variadic template constructor
          */
         template <typename T>
-        format(const std::string &str, const T &value) : format(str)
+        format(const std::string &str, T &&value) : format(str)
         {
-            args(value);  // add argument
+            args(std::forward<T>(value));  // add argument
         }
 
+        /*!
+         * how replacements are escaped for the text around them
+         */
+        enum class escaping : std::uint8_t {
+            none,  // as converted
+            json,  // for a JSON string: quote, backslash and control characters
+            html,  // for HTML text or attributes: < > & and quotes
+            csv    // for a CSV field: quoted when it holds a comma, quote or line break
+        };
+
+        /*!
+         * how a width is measured
+         */
+        enum class width_unit : std::uint8_t {
+            bytes,       // as streams do
+            codepoints,  // utf-8 characters
+            columns      // terminal columns: east asian wide characters take two, combining marks none
+        };
+
+        /*!
+         * a byte range of the rendered output
+         */
+        struct range {
+            std::size_t offset;
+            std::size_t length;
+        };
+
+        /*!
+         * the kinds of format string error
+         */
+        enum class parse_error : std::uint8_t {
+            none,
+            missing_close_tag,       // an opening tag without a closing tag
+            invalid_specifier,       // a repeated or misplaced separator, or an empty type
+            invalid_index,           // an index that is not a decimal number
+            invalid_name,            // a name that is not an identifier
+            invalid_width,           // a width that is not a decimal number
+            width_out_of_range,      // a width outside -128..127
+            invalid_escape,          // an escaping mode other than !n, !j, !h or !c
+            mixed_specifiers,        // named and positional specifiers in one format
+            duplicate_index,         // a positional index used twice
+            non_contiguous_indexes,  // positional indexes that skip a number
+            too_many_specifiers,     // more than max_specifiers specifiers
+            out_of_memory,           // try_parse could not allocate
+            build_failed             // try_parse could not build a validated format string
+        };
+
+        /*!
+         * the outcome of checking a format string
+         */
+        struct parse_result {
+            parse_error error;
+            std::size_t offset;  // the byte offset of the error in the format string
+
+            /*!
+             * @return true if there is no error
+             */
+            explicit operator bool() const noexcept
+            {
+                return error == parse_error::none;
+            }
+
+            /*!
+             * @return a description of the error
+             */
+            const char *message() const noexcept;
+        };
+
+        // the most specifiers a format string can have
+        static constexpr std::size_t max_specifiers = 65536;
+
+        /*!
+         * checks a format string in one pass without allocating or throwing
+         * @return the first error and its offset
+         */
+        static parse_result validate(std::string_view str) noexcept;
+
+        /*!
+         * parses a format string into out without throwing. out keeps its
+         * escaping and width unit, and is unchanged when there is an error.
+         * @return the first error and its offset
+         */
+        static parse_result try_parse(const std::string &str, format &out) noexcept;
+
         // constructors
 
         /*!
@@ -93,10 +449,16 @@ namespace coda
          */
         format(const format &other);
 
+        /*!
+         * move constructor. the storage of a basic_format is copied, since it
+         * lives inside the object being moved from. the moved from format is
+         * left empty, so a format it is an argument of shows nothing for it.
+         */
         format(format &&other);
 
         /*!
          * default constructor needs a format string
+         * @throws invalid_argument with the validate error and offset if the format string is invalid
          */
         format(const std::string &str);
 
@@ -105,7 +467,9 @@ namespace coda
         // operators
 
         /*!
-         * assigns a format to this instance
+         * assigns a format to this instance. a format argument of rhs that
+         * shows this format is replaced by a copy of its output, since it
+         * would show itself once assigned.
          */
         format &operator=(const format &rhs);
 
@@ -116,27 +480,39 @@ namespace coda
          * @throws invalid_argument if there was a formatting error
          * @see str
          */
-        operator std::string();
+        operator std::string() const;
 
         /*!
          * adds an argument to the format
          * @throws invalid_argument if there is no specifier for the value
          */
         template <typename T>
-        format &operator<<(const T &value)
+        format &operator<<(T &&value)
         {
-            return args(value);
+            return args(std::forward<T>(value));
         }
 
         // methods
 
+        /*!
+         * sets the escaping of arguments bound after this call whose specifier
+         * has no escaping of its own
+         */
+        format &escape(escaping mode);
+
+        /*!
+         * sets how the width of arguments bound after this call is measured.
+         * replacements that are all ascii are padded by their length in bytes.
+         */
+        format &measure(width_unit unit);
+
         /*!
          * converts the format with the given args and returns the string
          */
-        std::string str();
+        std::string str() const;
 
         /*!
-         * @return the number of specifiers in the format
+         * @return the number of arguments in the format that are not bound yet
          */
         std::size_t specifiers() const;
 
@@ -150,47 +526,612 @@ namespace coda
          */
         void reset();
 
-        void print(std::ostream &out);
+        void print(std::ostream &out) const;
+
+        /*!
+         * appends the formatted string to out, so several formats can share one buffer
+         */
+        void append_to(std::string &out) const;
+
+        /*!
+         * writes at most size characters of the formatted string to buffer, without a terminator
+         * @return the length of the whole formatted string
+         */
+        std::size_t format_to(char *buffer, std::size_t size) const;
+
+        /*!
+         * keeps the rendered output between calls and splices in only the
+         * arguments bound or reset since the last refresh. the first refresh
+         * renders everything.
+         * @param changed if not null, receives the ranges of the output that
+         * differ from the last refresh. a range ends at the end of the output
+         * once a replacement changes length, since the rest of it moved.
+         * @return the output, valid until the next refresh or reset
+         */
+        std::string_view refresh(std::vector<range> *changed = nullptr);
+
+       protected:
+        /*!
+         * a format allocating from resource, which must outlive it
+         * @throws invalid_argument with the validate error and offset if the format string is invalid
+         */
+        format(std::string_view str, std::pmr::memory_resource *resource);
+
+        /*!
+         * copies other, allocating from resource
+         */
+        format(const format &other, std::pmr::memory_resource *resource);
 
        private:
+        friend class catalog_writer;
+        friend class catalog_reader;
+
+        template <std::size_t InlineSpecifiers, std::size_t InlineBytes>
+        friend class basic_format;
+
         // private constants
         static const char s_open_tag = '{';
         static const char s_close_tag = '}';
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        // how an argument is converted, decoded from the specifier type
+        enum class conversion : std::uint8_t { general, fixed, scientific, hex, oct, dump, time, invalid };
+
+        // the zone of a time rendered with a Z suffix rather than an offset
+        static constexpr std::int16_t utc_zone = -32768;
+
+        // the fields of a specifier other than its strings
+        struct specifier_state {
+            std::size_t start;                 // the position of the opening tag in the format string
+            std::size_t length;                // the length including the tags
+            std::size_t index;                 // the argument index
+            std::size_t name;                  // the position of the name in the format string
+            std::size_t name_length;           // the name length, zero for a positional specifier
+            std::size_t repeat;                // the next specifier for the same argument, or npos
+            bool bound;                        // the replacement holds an argument
+            bool dirty;                        // changed since the last refresh
+            char type;                         // the specifier
+            std::int8_t width;                 // width of the replacement
+            conversion convert;                // decoded from the type
+            bool uppercase;                    // uppercase digits and exponent
+            bool newline;                      // append a new line
+            char fill;                         // the padding character
+            std::uint8_t padding;              // the minimum length of the value
+            int precision;                     // decoded precision for floating point
+            std::uint8_t group;                // bytes between separators in a hex dump, zero for none
+            char separator;                    // the hex dump group separator
+            std::int16_t zone;                 // minutes east of UTC for a time, or utc_zone
+            const format *nested;              // a format argument rendered in place, or null
+            escaping escape;                   // the escaping of the replacement
+            bool inherit;                      // escaped as the format default instead
+            std::ios_base::fmtflags flags;     // stream flags for operator<< arguments
+        };
+
+        // struct for a single specifier in the format, allocating its
+        // strings from the resource of the format
+        struct specifier : specifier_state {
+            typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+            std::pmr::string format;       // the type argument
+            std::pmr::string replacement;  // the replacement value
+
+            specifier() = default;
+            specifier(const specifier &other) = default;
+            specifier(specifier &&other) = default;
+
+            explicit specifier(const allocator_type &allocator)
+                : specifier_state(), format(allocator), replacement(allocator)
+            {
+            }
+
+            specifier(const specifier &other, const allocator_type &allocator)
+                : specifier_state(other), format(other.format, allocator), replacement(other.replacement, allocator)
+            {
+            }
+
+            specifier(specifier &&other, const allocator_type &allocator)
+                : specifier_state(other),
+                  format(std::move(other.format), allocator),
+                  replacement(std::move(other.replacement), allocator)
+            {
+            }
+
+            specifier &operator=(const specifier &rhs) = default;
+            specifier &operator=(specifier &&rhs) = default;
+        };
+
+        // render program operations
+        enum class opcode : std::uint8_t { copy_literal, emit_arg };
 
-        // struct for a single specifier in the format
-        typedef struct {
-            std::string::size_type prev;  // the prev position in format string
-            std::string::size_type next;  // the next position in format string
-            std::size_t index;            // the argument index
-            std::string format;           // the format
-            char type;                    // the specifier
-            std::int8_t width;            // width of the replacement
-            std::string replacement;      // the replacement value
-        } specifier;
+        struct instruction {
+            opcode code;
+            std::size_t offset;  // literal pool offset, or specifier slot
+            std::size_t length;  // literal length
+        };
 
-        typedef std::list<specifier> SpecifierList;  // for sorting
+        // the first specifier of each argument is at its index, repeated names follow
+        typedef std::pmr::vector<specifier> SpecifierList;
+        typedef std::pmr::vector<instruction> Program;  // in format string order
+
+        /*!
+         * @return the inline storage of a basic_format, room for the strings
+         * and for the specifiers with their program instructions
+         */
+        static constexpr std::size_t inline_size(std::size_t specifiers, std::size_t bytes)
+        {
+            return specifiers * (sizeof(specifier) + sizeof(instruction) * 2) + bytes;
+        }
+
+        /*!
+         * a stream that appends to a string, reused by each thread so binding
+         * an argument does not construct a stream. formatting state is reset
+         * on every use, and the stream follows the global locale. a nested
+         * use, from an argument's own operator<<, gets a stream of its own.
+         */
+        class argument_stream
+        {
+           public:
+            explicit argument_stream(std::pmr::string &out);
+            argument_stream(const argument_stream &other) = delete;
+            argument_stream &operator=(const argument_stream &rhs) = delete;
+            ~argument_stream();
+
+            std::ostream &stream();
+
+           private:
+            struct state;
+            state *state_;  // the reused or nested stream state
+            bool owned_;    // true when this is a nested stream
+        };
 
         // private methods
 
         /*!
-         * creates the specifier list from the format string
+         * an empty format, filled in by load
+         */
+        format();
+
+        /*!
+         * a format allocating from resource, parsed only if parse is true
+         */
+        format(std::string_view str, std::pmr::memory_resource *resource, bool parse);
+
+        /*!
+         * appends the parsed state to a compiled catalog template
+         */
+        void save(std::string &out) const;
+
+        /*!
+         * restores the parsed state from a compiled catalog template
+         * @throws invalid_argument if the data is corrupt
+         */
+        void load(const char *data, std::size_t length);
+
+        /*!
+         * renders a value into every specifier of an argument
+         */
+        template <typename T>
+        void bind_argument(std::size_t index, const T &value)
+        {
+            const bool bound = specifiers_[index].bound;
+
+            for (auto slot = index; slot != npos; slot = specifiers_[slot].repeat) {
+                auto &spec = specifiers_[slot];
+
+                spec.nested = nullptr;
+
+                if ((spec.inherit ? escape_ : spec.escape) == escaping::none) {
+                    bind(spec, value);
+                } else {
+                    // the width and new line belong to the text around the
+                    // value, so they are applied once it is escaped
+                    const auto width = spec.width;
+                    const auto padding = spec.padding;
+                    const auto newline = spec.newline;
+
+                    spec.width = 0;
+                    spec.padding = 0;
+                    spec.newline = false;
+
+                    try {
+                        bind(spec, value);
+                    } catch (...) {
+                        spec.width = width;
+                        spec.padding = padding;
+                        spec.newline = newline;
+                        throw;
+                    }
+
+                    spec.width = width;
+                    spec.padding = padding;
+                    spec.newline = newline;
+
+                    escape_replacement(spec);
+                }
+
+                spec.bound = true;
+                spec.dirty = true;
+            }
+
+            if (!bound) {
+                --unbound_;
+            }
+        }
+
+        /*!
+         * renders a value into the specifier replacement, choosing the
+         * conversion from the value type
+         */
+        template <typename T>
+        void bind(specifier &arg, const T &value)
+        {
+            if constexpr (detail::has_formatter<T>::value) {
+                formatter<T> custom;
+
+                if constexpr (detail::has_formatter_parse<T>::value) {
+                    custom.parse(arg.type, std::string_view(arg.format));
+                } else if constexpr (detail::has_formatter_string_parse<T>::value) {
+                    custom.parse(arg.type, std::string(arg.format.data(), arg.format.size()));
+                }
+
+                arg.replacement.clear();
+
+                format_sink sink(arg.replacement);
+                custom.format(value, sink);
+
+                pad(arg);
+            } else if constexpr (detail::is_joined<T>::value) {
+                bind_range(arg, value.range, value.separator);
+            } else if constexpr (std::is_base_of<format, T>::value) {
+                bind_format(arg, value);
+            } else if constexpr (std::is_same<T, bool>::value) {
+                convert_integer(arg, value, value, false);
+            } else if constexpr (detail::is_character<T>::value) {
+                const char ch = static_cast<char>(value);
+                convert_string(arg, &ch, 1);
+            } else if constexpr (detail::is_integer<T>::value) {
+                if (localized(arg)) {
+                    bind_stream(arg, value);
+                    return;
+                }
+
+                typedef typename std::make_unsigned<T>::type unsigned_type;
+
+                // hex and octal show the bits of the value, as streams do
+                const auto bits = static_cast<unsigned_type>(value);
+                const bool negative = std::is_signed<T>::value && value < 0;
+
+                convert_integer(arg, bits, negative ? static_cast<unsigned_type>(0 - bits) : bits, negative);
+            } else if constexpr (std::is_same<T, double>::value || std::is_same<T, float>::value) {
+                if (localized(arg)) {
+                    bind_stream(arg, value);
+                } else {
+                    convert_floating(arg, value);
+                }
+            } else if constexpr (detail::is_string<T>::value) {
+                const std::string_view str(value);
+                convert_string(arg, str.data(), str.size());
+            } else if constexpr (detail::is_byte_range<T>::value) {
+                if constexpr (detail::is_character_array<T>::value) {
+                    // they are only dumped with an h type, so they render as they always have
+                    if (arg.convert != conversion::dump) {
+                        bind_stream(arg, value);
+                        return;
+                    }
+                }
+
+                const auto *data = std::data(value);
+                convert_bytes(arg, reinterpret_cast<const unsigned char *>(data), std::size(value) * sizeof(*data));
+            } else if constexpr (detail::is_time_point<T>::value) {
+                // whole seconds and the nanoseconds past them, so any duration keeps its range
+                const auto seconds = std::chrono::floor<std::chrono::seconds>(value);
+                const auto fraction = std::chrono::duration_cast<std::chrono::nanoseconds>(value - seconds);
+
+                convert_time(arg, seconds.time_since_epoch().count(), static_cast<std::uint32_t>(fraction.count()));
+            } else {
+                bind_stream(arg, value);
+            }
+        }
+
+        /*!
+         * writes the argument value into the replacement with operator<<
+         */
+        template <typename T>
+        void bind_stream(specifier &arg, const T &value) const
+        {
+            arg.replacement.clear();
+
+            argument_stream buf(arg.replacement);
+
+            begin_manip(buf.stream(), arg);  // set stream flags for arg
+            buf.stream() << value;           // append value
+            end_manip(buf.stream(), arg);    // cleanup stream from arg
+        }
+
+        /*!
+         * @return true if a built-in number is written by the stream, because
+         * the global locale is not the classic one the direct conversions follow
+         */
+        static bool localized(const specifier &arg);
+
+        /*!
+         * renders every element of a range into the specifier replacement.
+         * contiguous integer and floating point ranges are widened in blocks
+         * for the batched conversions, other elements are bound one by one,
+         * as are numbers written with a global locale.
+         */
+        template <typename Range>
+        void bind_range(specifier &arg, const Range &range, std::string_view separator)
+        {
+            typedef typename std::decay<decltype(*std::begin(range))>::type element_type;
+
+            static const std::size_t block_size = 64;
+
+            arg.replacement.clear();
+
+            if constexpr (detail::is_contiguous<Range>::value && detail::is_integer<element_type>::value) {
+                if (localized(arg)) {
+                    bind_elements(arg, range, separator);
+                } else {
+                    typedef typename std::make_unsigned<element_type>::type unsigned_type;
+
+                    const auto *values = std::data(range);
+                    const std::size_t count = std::size(range);
+                    std::uint64_t block[block_size];
+
+                    for (std::size_t i = 0; i < count; i += block_size) {
+                        const auto length = std::min(block_size, count - i);
+                        for (std::size_t j = 0; j < length; ++j) {
+                            block[j] = static_cast<unsigned_type>(values[i + j]);
+                        }
+                        append_integers(arg, block, length, sizeof(element_type),
+                                        std::is_signed<element_type>::value, separator, i == 0);
+                    }
+                }
+            } else if constexpr (detail::is_contiguous<Range>::value &&
+                                 (std::is_same<element_type, double>::value ||
+                                  std::is_same<element_type, float>::value)) {
+                if (localized(arg)) {
+                    bind_elements(arg, range, separator);
+                } else {
+                    const auto *values = std::data(range);
+                    const std::size_t count = std::size(range);
+                    double block[block_size];
+
+                    for (std::size_t i = 0; i < count; i += block_size) {
+                        const auto length = std::min(block_size, count - i);
+                        for (std::size_t j = 0; j < length; ++j) {
+                            block[j] = values[i + j];
+                        }
+                        append_floating(arg, block, length, separator, i == 0);
+                    }
+                }
+            } else {
+                bind_elements(arg, range, separator);
+            }
+
+            if (arg.newline) {
+                arg.replacement.push_back('\n');
+            }
+        }
+
+        /*!
+         * binds the elements of a range one by one with the specifier,
+         * appending them to its replacement
+         */
+        template <typename Range>
+        void bind_elements(specifier &arg, const Range &range, std::string_view separator)
+        {
+            specifier element(arg, arg.replacement.get_allocator());
+            element.newline = false;
+            element.nested = nullptr;
+
+            bool first = true;
+            for (const auto &value : range) {
+                if (!first) {
+                    arg.replacement.append(separator.data(), separator.size());
+                }
+                first = false;
+
+                bind(element, value);
+
+                // elements are copied, a range has no place to keep them
+                if (element.nested != nullptr) {
+                    flatten(element);
+                }
+
+                arg.replacement.append(element.replacement);
+            }
+        }
+
+        /*!
+         * creates the specifier list and render program from the format string
          * @throws invalid_argument if the format string is invalid
          */
         void initialize();
+
+        /*!
+         * validates str, counting its specifiers
+         */
+        static parse_result validate(std::string_view str, std::size_t &count) noexcept;
+
+        /*!
+         * creates the specifier list and render program from a validated format string
+         * with count specifiers
+         */
+        void build(std::size_t count);
         void add_specifier(std::string::size_type start, std::string::size_type end);
+        void add_literal(std::string::size_type start, std::string::size_type end);
+        void order_arguments();
+        void build_names();
+
+        /*!
+         * @return the name of the argument with an index
+         */
+        std::string_view name_of(std::size_t index) const;
+
+        /*!
+         * @return the argument index for a name, or npos
+         */
+        std::size_t find_argument(std::string_view name) const;
         void begin_manip(std::ostream &out, const specifier &arg) const;
-        void end_manip(std::ostream &out, const specifier &arg);
-        void unescape(std::ostream &buf, std::string::size_type start, std::string::size_type end);
+        void end_manip(std::ostream &out, specifier &arg) const;
+
+        /*!
+         * pads the replacement to the specifier padding with its fill
+         */
+        void pad(specifier &arg) const;
+
+        /*!
+         * @return the width of a value in the unit set by measure
+         */
+        std::size_t display_width(const char *value, std::size_t length) const;
+
+        /*!
+         * direct conversions for built-in types
+         * @throws invalid_argument if the specifier precision is invalid
+         */
+        void convert_integer(specifier &arg, std::uint64_t bits, std::uint64_t magnitude, bool negative) const;
+        void convert_floating(specifier &arg, double value) const;
+        std::size_t write_floating(const specifier &arg, double value, char *buf, std::size_t size) const;
+        void convert_string(specifier &arg, const char *value, std::size_t length) const;
+        void convert_bytes(specifier &arg, const unsigned char *value, std::size_t length) const;
+
+        /*!
+         * renders a time as ISO 8601 with the digits and zone of a t specifier
+         * @param seconds the seconds since the epoch
+         * @param nanoseconds the nanoseconds past them, below one second
+         * @throws invalid_argument if the specifier is not for a time
+         */
+        void convert_time(specifier &arg, std::int64_t seconds, std::uint32_t nanoseconds) const;
+        void emit(specifier &arg, const char *value, std::size_t length) const;
+
+        // format arguments bound from a temporary, which are copied
+        template <typename T>
+        static constexpr bool is_temporary_format =
+            std::is_base_of<format, typename std::decay<T>::type>::value && !std::is_lvalue_reference<T>::value;
+
+        /*!
+         * captures a format argument to render in place, or copies its
+         * output when it is escaped or refers back to this format
+         * @throws invalid_argument if the specifier has a precision or time type
+         */
+        void bind_format(specifier &arg, const format &value) const;
+
+        /*!
+         * renders a format argument, with the padding of its specifier, into the replacement
+         */
+        void expand(specifier &arg, const format &value) const;
 
-        // private member variables
-        std::string value_;                         // the format
-        SpecifierList specifiers_;                  // the list of specifiers in the format
-        SpecifierList::iterator currentSpecifier_;  // the current specifier
+        /*!
+         * replaces the format argument of a specifier by a copy of its output
+         */
+        void flatten(specifier &arg) const;
+
+        /*!
+         * copies the output of a format argument into every specifier of the argument
+         */
+        void detach(std::size_t index);
+
+        /*!
+         * @return true if target is this format or a format argument of it, at any depth
+         */
+        bool refers_to(const format *target) const;
+
+        /*!
+         * replaces every format argument showing target by a copy of its output
+         */
+        void detach_from(const format *target);
+
+        /*!
+         * copies the members of another format, keeping this storage
+         */
+        void assign(const format &rhs);
+
+        /*!
+         * empties a format whose contents were moved to another
+         */
+        void clear_moved();
+
+        struct nested_fills;
+
+        /*!
+         * measures the output in a unit without rendering it, once per format
+         * argument. the fill of each padded format argument, in the unit of
+         * the format holding it, is appended in the order rendering reaches it.
+         * @param fills receives the fills, or null when only the width is needed
+         * @return the width of the output
+         */
+        std::size_t measure_output(width_unit unit, nested_fills *fills) const;
+
+        /*!
+         * renders a format argument into an output sink with the padding of its specifier
+         */
+        template <typename Sink>
+        void render_nested(Sink &out, const specifier &arg, const format &value) const;
+
+        /*!
+         * renders a format argument, taking the fills of it and the padded
+         * arguments below it from those measured, or measuring them when none are
+         */
+        template <typename Sink>
+        void render_argument(Sink &out, const specifier &arg, const format &value, const std::size_t *&fills) const;
+
+        /*!
+         * escapes an unpadded replacement, then pads it and appends its new line
+         */
+        void escape_replacement(specifier &arg) const;
+
+        /*!
+         * escapes the replacement in place, unless no character needs it
+         */
+        void escape_value(specifier &arg) const;
+        static char *write_padded(char *pos, const specifier &arg, const char *value, std::size_t length);
+
+        /*!
+         * batched conversions appending range elements, each padded, to the
+         * replacement with the separator before all but the first element
+         * @param size the size in bytes of the original integer type
+         * @throws invalid_argument if the specifier precision is invalid
+         */
+        void append_integers(specifier &arg, const std::uint64_t *values, std::size_t count, std::size_t size,
+                             bool is_signed, std::string_view separator, bool first) const;
+        void append_floating(specifier &arg, const double *values, std::size_t count, std::string_view separator,
+                             bool first) const;
+
+        /*!
+         * executes the render program into an output sink
+         */
+        template <typename Sink>
+        void render(Sink &out) const;
+
+        /*!
+         * executes the render program with the fills of its padded format arguments,
+         * or null to measure them as they are reached
+         */
+        template <typename Sink>
+        void render_program(Sink &out, const std::size_t *&fills) const;
 
-        friend std::ostream &operator<<(std::ostream &out, format &f);
+        // private member variables, allocated from one resource
+        std::pmr::string value_;                         // the format
+        std::pmr::string literals_;                      // the unescaped literal text of the format
+        SpecifierList specifiers_;                       // the specifiers in the format
+        Program program_;                                // the render program
+        std::size_t arguments_;                          // the number of arguments
+        std::size_t cursor_;                             // the next argument for args()
+        std::size_t unbound_;                            // the number of arguments not bound
+        std::pmr::vector<std::size_t> names_;            // perfect hash slots of argument index + 1
+        std::pmr::vector<std::uint32_t> displacements_;  // the slot hash for each name bucket
+        std::uint64_t seed_;                             // the name hash seed
+        std::pmr::string rendered_;                      // the output of the last refresh
+        std::pmr::vector<range> segments_;               // the output range of each specifier
+        bool refreshed_;                                 // rendered_ matches the segments
+        escaping escape_;                                // the default escaping of arguments
+        width_unit measure_;                             // how argument widths are measured
+        mutable bool referenced_;                        // has been bound by reference into another format
     };
 
-    std::ostream &operator<<(std::ostream &out, format &f);
+    std::ostream &operator<<(std::ostream &out, const format &f);
 }
 
 #endif
@@ -0,0 +1,122 @@
+/*!
+ * implementation of the inline format storage
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/basic_format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace coda
+{
+    namespace detail
+    {
+        namespace
+        {
+            // blocks are whole units of the largest fundamental alignment, so freed blocks meet without gaps
+            constexpr std::size_t granule = alignof(std::max_align_t);
+
+            std::size_t round_up(std::size_t bytes)
+            {
+                return (bytes + granule - 1) / granule * granule;
+            }
+        }
+
+        inline_resource::inline_resource(void *buffer, std::size_t size)
+            : buffer_(static_cast<char *>(buffer)),
+              size_(size),
+              used_(0),
+              blocks_(0),
+              overflow_(0),
+              ranges_(),
+              range_count_(0)
+        {
+        }
+
+        std::size_t inline_resource::overflow() const
+        {
+            return overflow_;
+        }
+
+        void *inline_resource::do_allocate(std::size_t bytes, std::size_t alignment)
+        {
+            const auto rounded = round_up(bytes == 0 ? 1 : bytes);
+            const auto address = reinterpret_cast<std::uintptr_t>(buffer_) + used_;
+            const auto start = used_ + ((alignment - address % alignment) % alignment);
+
+            if (rounded >= bytes && start <= size_ && rounded <= size_ - start) {
+                // the padding of an over aligned block is freed space below it
+                if (start != used_) {
+                    release(used_, start);
+                }
+                used_ = start + rounded;
+                ++blocks_;
+                return buffer_ + start;
+            }
+
+            auto block = ::operator new(bytes, std::align_val_t(alignment));
+            overflow_ += bytes;
+            return block;
+        }
+
+        void inline_resource::do_deallocate(void *block, std::size_t bytes, std::size_t alignment)
+        {
+            const auto address = static_cast<char *>(block);
+
+            if (address < buffer_ || address >= buffer_ + size_) {
+                overflow_ -= bytes;
+                ::operator delete(block, bytes, std::align_val_t(alignment));
+                return;
+            }
+
+            if (--blocks_ == 0) {
+                used_ = range_count_ = 0;
+                return;
+            }
+
+            const auto start = static_cast<std::size_t>(address - buffer_);
+            release(start, start + round_up(bytes == 0 ? 1 : bytes));
+        }
+
+        void inline_resource::release(std::size_t start, std::size_t end)
+        {
+            // the first range at or above the freed block, which may merge with the one before it
+            std::size_t next = 0;
+            while (next < range_count_ && ranges_[next].start < start) {
+                ++next;
+            }
+
+            if (next > 0 && ranges_[next - 1].end == start) {
+                start = ranges_[--next].start;
+                std::copy(ranges_ + next + 1, ranges_ + range_count_, ranges_ + next);
+                --range_count_;
+            }
+            if (next < range_count_ && ranges_[next].start == end) {
+                end = ranges_[next].end;
+                std::copy(ranges_ + next + 1, ranges_ + range_count_, ranges_ + next);
+                --range_count_;
+            }
+
+            // free space reaching the end of the buffer in use is given back
+            if (end == used_) {
+                used_ = start;
+                return;
+            }
+
+            if (range_count_ == max_ranges) {
+                return;
+            }
+
+            std::copy_backward(ranges_ + next, ranges_ + range_count_, ranges_ + range_count_ + 1);
+            ranges_[next] = range{start, end};
+            ++range_count_;
+        }
+
+        bool inline_resource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+        {
+            return this == &other;
+        }
+    }
+}
@@ -0,0 +1,121 @@
+/*!
+ * implementation of the capture writer
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/capture.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstddef>
+
+#include "format.h"
+
+namespace coda
+{
+    capture_writer::capture_writer(const std::string &path, std::size_t capacity)
+        : fd_(-1), map_(nullptr), capacity_(capacity), pending_(0), arguments_()
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ == -1) {
+            throw std::runtime_error("unable to create capture file");
+        }
+
+        const auto length = sizeof(capture::header) + capacity_;
+
+        if (::ftruncate(fd_, static_cast<off_t>(length)) == -1) {
+            ::close(fd_);
+            throw std::runtime_error("unable to size capture file");
+        }
+
+        void *map = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd_);
+            throw std::runtime_error("unable to map capture file");
+        }
+
+        map_ = static_cast<char *>(map);
+
+        capture::header header;
+        std::memcpy(header.magic, capture::magic, sizeof(header.magic));
+        header.version = capture::version;
+        header.byte_order = capture::byte_order;
+        header.capacity = capacity_;
+        header.used = 0;
+        std::memcpy(map_, &header, sizeof(header));
+    }
+
+    capture_writer::~capture_writer()
+    {
+        const std::uint64_t used = size();
+
+        // an unused tail would only be zero padding for the reader to skip
+        std::memcpy(map_ + offsetof(capture::header, capacity), &used, sizeof(used));
+
+        ::munmap(map_, sizeof(capture::header) + capacity_);
+
+        if (::ftruncate(fd_, static_cast<off_t>(sizeof(capture::header) + used)) == -1) {
+            // the file stays readable at its full capacity
+        }
+
+        ::close(fd_);
+    }
+
+    std::uint32_t capture_writer::define(const std::string &str)
+    {
+        const format parsed(str);
+
+        const auto id = static_cast<std::uint32_t>(arguments_.size());
+
+        char *pos = reserve(sizeof(std::uint8_t) + sizeof(std::uint32_t) * 2 + str.size());
+
+        pos = put(pos, static_cast<std::uint8_t>(capture::define_entry));
+        pos = put(pos, id);
+        pos = put(pos, static_cast<std::uint32_t>(str.size()));
+        std::memcpy(pos, str.data(), str.size());
+
+        arguments_.push_back(parsed.specifiers());
+
+        commit();
+
+        return id;
+    }
+
+    std::size_t capture_writer::size() const
+    {
+        return static_cast<std::size_t>(__atomic_load_n(used_field(), __ATOMIC_ACQUIRE));
+    }
+
+    void capture_writer::flush()
+    {
+        ::msync(map_, sizeof(capture::header) + capacity_, MS_SYNC);
+    }
+
+    char *capture_writer::reserve(std::size_t length)
+    {
+        const auto used = size();
+
+        if (length > capacity_ - used) {
+            throw std::length_error("capture file is full");
+        }
+
+        pending_ = used + length;
+
+        return map_ + sizeof(capture::header) + used;
+    }
+
+    void capture_writer::commit()
+    {
+        // a release store, so a reader loading the used length with acquire
+        // sees every byte of the records it covers
+        __atomic_store_n(used_field(), static_cast<std::uint64_t>(pending_), __ATOMIC_RELEASE);
+    }
+
+    std::uint64_t *capture_writer::used_field() const
+    {
+        // the mapping is page aligned and the field is at an offset of 24, so it is naturally aligned
+        return reinterpret_cast<std::uint64_t *>(map_ + offsetof(capture::header, used));
+    }
+}
@@ -0,0 +1,384 @@
+/*!
+ * implementation of precompiled catalogs
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/catalog.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace coda
+{
+    namespace
+    {
+        static const std::uint32_t no_repeat = std::numeric_limits<std::uint32_t>::max();
+
+        template <typename T>
+        void put(std::string &out, const T &value)
+        {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        void put_string(std::string &out, std::string_view value)
+        {
+            put(out, static_cast<std::uint32_t>(value.size()));
+            out.append(value);
+        }
+
+        // bounds checked reads of a compiled template
+        struct template_reader {
+            const char *pos;
+            const char *end;
+
+            const char *read(std::size_t length)
+            {
+                if (length > static_cast<std::size_t>(end - pos)) {
+                    throw std::invalid_argument("invalid catalog template");
+                }
+
+                const char *value = pos;
+                pos += length;
+                return value;
+            }
+
+            template <typename T>
+            T get()
+            {
+                T value;
+                std::memcpy(&value, read(sizeof(T)), sizeof(T));
+                return value;
+            }
+
+            std::string get_string()
+            {
+                const auto length = get<std::uint32_t>();
+                return std::string(read(length), length);
+            }
+
+            // a count of records of at least size bytes that fit in the rest of the template
+            std::size_t get_count(std::size_t size)
+            {
+                const auto count = get<std::uint32_t>();
+                if (count > static_cast<std::size_t>(end - pos) / size) {
+                    throw std::invalid_argument("invalid catalog template");
+                }
+                return count;
+            }
+        };
+
+        void check(bool valid)
+        {
+            if (!valid) {
+                throw std::invalid_argument("invalid catalog template");
+            }
+        }
+
+        bool power_of_two(std::size_t value)
+        {
+            return value != 0 && (value & (value - 1)) == 0;
+        }
+    }
+
+    void format::save(std::string &out) const
+    {
+        put_string(out, value_);
+        put_string(out, literals_);
+        put(out, static_cast<std::uint32_t>(arguments_));
+
+        put(out, static_cast<std::uint32_t>(specifiers_.size()));
+        for (const auto &spec : specifiers_) {
+            put(out, static_cast<std::uint32_t>(spec.start));
+            put(out, static_cast<std::uint32_t>(spec.length));
+            put(out, static_cast<std::uint32_t>(spec.index));
+            put(out, static_cast<std::uint32_t>(spec.name));
+            put(out, static_cast<std::uint32_t>(spec.name_length));
+            put(out, spec.repeat == npos ? no_repeat : static_cast<std::uint32_t>(spec.repeat));
+            put(out, static_cast<std::int32_t>(spec.precision));
+            put(out, static_cast<std::uint32_t>(spec.flags));
+            put(out, spec.type);
+            put(out, spec.width);
+            put(out, static_cast<std::uint8_t>(spec.convert));
+            put(out, static_cast<std::uint8_t>(spec.uppercase));
+            put(out, static_cast<std::uint8_t>(spec.newline));
+            put(out, spec.fill);
+            put(out, spec.padding);
+            put(out, spec.group);
+            put(out, spec.separator);
+            put(out, spec.zone);
+            put(out, static_cast<std::uint8_t>(spec.escape));
+            put(out, static_cast<std::uint8_t>(spec.inherit));
+            put_string(out, spec.format);
+        }
+
+        put(out, static_cast<std::uint32_t>(program_.size()));
+        for (const auto &op : program_) {
+            put(out, static_cast<std::uint32_t>(op.code));
+            put(out, static_cast<std::uint32_t>(op.offset));
+            put(out, static_cast<std::uint32_t>(op.length));
+        }
+
+        put(out, seed_);
+        put(out, static_cast<std::uint32_t>(displacements_.size()));
+        for (const auto displacement : displacements_) {
+            put(out, displacement);
+        }
+        put(out, static_cast<std::uint32_t>(names_.size()));
+        for (const auto entry : names_) {
+            put(out, static_cast<std::uint32_t>(entry));
+        }
+    }
+
+    void format::load(const char *data, std::size_t length)
+    {
+        // every value is checked against what initialize could have produced,
+        // so a corrupt template cannot index out of bounds or loop when bound
+        template_reader in{data, data + length};
+
+        value_ = in.get_string();
+        literals_ = in.get_string();
+        arguments_ = in.get<std::uint32_t>();
+
+        const auto count = in.get_count(49);
+        check(arguments_ <= count);
+
+        specifiers_.resize(count);
+        for (std::size_t slot = 0; slot < count; ++slot) {
+            auto &spec = specifiers_[slot];
+
+            spec.start = in.get<std::uint32_t>();
+            spec.length = in.get<std::uint32_t>();
+            spec.index = in.get<std::uint32_t>();
+            spec.name = in.get<std::uint32_t>();
+            spec.name_length = in.get<std::uint32_t>();
+
+            const auto repeat = in.get<std::uint32_t>();
+            spec.repeat = repeat == no_repeat ? npos : repeat;
+
+            spec.precision = in.get<std::int32_t>();
+            spec.flags = static_cast<std::ios_base::fmtflags>(in.get<std::uint32_t>());
+            spec.type = in.get<char>();
+            spec.width = in.get<std::int8_t>();
+
+            const auto convert = in.get<std::uint8_t>();
+            check(convert <= static_cast<std::uint8_t>(conversion::invalid));
+            spec.convert = static_cast<conversion>(convert);
+
+            spec.uppercase = in.get<std::uint8_t>() != 0;
+            spec.newline = in.get<std::uint8_t>() != 0;
+            spec.fill = in.get<char>();
+            spec.padding = in.get<std::uint8_t>();
+            spec.group = in.get<std::uint8_t>();
+            spec.separator = in.get<char>();
+            spec.zone = in.get<std::int16_t>();
+
+            const auto escape = in.get<std::uint8_t>();
+            check(escape <= static_cast<std::uint8_t>(escaping::csv));
+            spec.escape = static_cast<escaping>(escape);
+            spec.inherit = in.get<std::uint8_t>() != 0;
+            spec.format = in.get_string();
+
+            spec.nested = nullptr;
+            spec.bound = false;
+            spec.dirty = false;
+
+            check(spec.start <= value_.size() && spec.length <= value_.size() - spec.start);
+            check(spec.name <= value_.size() && spec.name_length <= value_.size() - spec.name);
+            check(spec.index < arguments_ && (slot >= arguments_ || spec.index == slot));
+            check(spec.precision >= 0 && spec.precision <= 127 && spec.group <= 127);
+            check(spec.convert != conversion::time || spec.precision <= 9);
+            check(spec.zone == utc_zone || (spec.zone > -1440 && spec.zone < 1440));
+
+            // repeats follow the first specifier of an argument, which ends every chain
+            check(spec.repeat == npos || (spec.repeat > slot && spec.repeat >= arguments_ && spec.repeat < count));
+        }
+
+        const auto instructions = in.get_count(12);
+
+        program_.resize(instructions);
+        std::vector<bool> emitted(count, false);
+        std::size_t emits = 0;
+        for (auto &op : program_) {
+            const auto code = in.get<std::uint32_t>();
+            op.offset = in.get<std::uint32_t>();
+            op.length = in.get<std::uint32_t>();
+
+            if (code == static_cast<std::uint32_t>(opcode::emit_arg)) {
+                op.code = opcode::emit_arg;
+                check(op.offset < count && op.length == 0 && !emitted[op.offset]);
+                emitted[op.offset] = true;
+                ++emits;
+            } else {
+                check(code == static_cast<std::uint32_t>(opcode::copy_literal));
+                op.code = opcode::copy_literal;
+                check(op.offset <= literals_.size() && op.length <= literals_.size() - op.offset);
+            }
+        }
+
+        // every specifier is rendered exactly once
+        check(emits == count);
+
+        seed_ = in.get<std::uint64_t>();
+
+        displacements_.resize(in.get_count(sizeof(std::uint32_t)));
+        for (auto &displacement : displacements_) {
+            displacement = in.get<std::uint32_t>();
+        }
+
+        names_.resize(in.get_count(sizeof(std::uint32_t)));
+        for (auto &entry : names_) {
+            entry = in.get<std::uint32_t>();
+            check(entry <= arguments_);
+        }
+
+        if (displacements_.empty()) {
+            // names without a hash table are every argument, sorted for a binary search
+            check(names_.empty() || names_.size() == arguments_);
+            for (std::size_t i = 0; i < names_.size(); ++i) {
+                check(names_[i] != 0);
+                check(i == 0 || name_of(names_[i - 1] - 1) < name_of(names_[i] - 1));
+            }
+        } else {
+            check(power_of_two(names_.size()) && power_of_two(displacements_.size()));
+        }
+        check(in.pos == in.end);
+
+        cursor_ = 0;
+        unbound_ = arguments_;
+        rendered_.clear();
+        segments_.clear();
+        refreshed_ = false;
+    }
+
+    catalog_writer::catalog_writer() : templates_(), index_()
+    {
+    }
+
+    std::uint32_t catalog_writer::add(const std::string &str)
+    {
+        const format parsed(str);
+
+        const auto id = static_cast<std::uint32_t>(index_.size());
+
+        catalog::entry entry;
+        entry.offset = templates_.size();
+        parsed.save(templates_);
+        entry.length = templates_.size() - entry.offset;
+
+        index_.push_back(entry);
+
+        return id;
+    }
+
+    std::size_t catalog_writer::size() const
+    {
+        return index_.size();
+    }
+
+    void catalog_writer::write(const std::string &path) const
+    {
+        catalog::header header;
+        std::memcpy(header.magic, catalog::magic, sizeof(header.magic));
+        header.version = catalog::version;
+        header.byte_order = catalog::byte_order;
+        header.count = index_.size();
+        header.index = sizeof(header) + templates_.size();
+        header.length = header.index + index_.size() * sizeof(catalog::entry);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(templates_.data(), static_cast<std::streamsize>(templates_.size()));
+
+        for (auto entry : index_) {
+            entry.offset += sizeof(header);
+            out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        }
+
+        out.close();
+
+        if (!out) {
+            throw std::runtime_error("unable to write catalog file");
+        }
+    }
+
+    catalog_reader::catalog_reader(const std::string &path) : map_(nullptr), length_(0), count_(0), index_(0)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error("unable to open catalog file");
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) == -1) {
+            ::close(fd);
+            throw std::runtime_error("unable to open catalog file");
+        }
+
+        length_ = static_cast<std::size_t>(info.st_size);
+
+        if (length_ < sizeof(catalog::header)) {
+            ::close(fd);
+            throw std::invalid_argument("invalid catalog file");
+        }
+
+        void *map = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("unable to map catalog file");
+        }
+
+        map_ = static_cast<const char *>(map);
+
+        catalog::header header;
+        std::memcpy(&header, map_, sizeof(header));
+
+        if (std::memcmp(header.magic, catalog::magic, sizeof(header.magic)) != 0 ||
+            header.version != catalog::version || header.byte_order != catalog::byte_order ||
+            header.length != length_ || header.index < sizeof(header) || header.index > length_ ||
+            header.count != (length_ - header.index) / sizeof(catalog::entry) ||
+            (length_ - header.index) % sizeof(catalog::entry) != 0) {
+            ::munmap(const_cast<char *>(map_), length_);
+            throw std::invalid_argument("invalid catalog file");
+        }
+
+        count_ = static_cast<std::size_t>(header.count);
+        index_ = static_cast<std::size_t>(header.index);
+    }
+
+    catalog_reader::~catalog_reader()
+    {
+        ::munmap(const_cast<char *>(map_), length_);
+    }
+
+    std::size_t catalog_reader::size() const
+    {
+        return count_;
+    }
+
+    format catalog_reader::get(std::uint32_t id) const
+    {
+        if (id >= count_) {
+            throw std::invalid_argument("unknown catalog template");
+        }
+
+        catalog::entry entry;
+        std::memcpy(&entry, map_ + index_ + id * sizeof(entry), sizeof(entry));
+
+        if (entry.offset < sizeof(catalog::header) || entry.offset > index_ || entry.length > index_ - entry.offset) {
+            throw std::invalid_argument("invalid catalog template");
+        }
+
+        format compiled;
+        compiled.load(map_ + entry.offset, static_cast<std::size_t>(entry.length));
+        return compiled;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CODA_FORMAT_COUNTERS_H
+#define CODA_FORMAT_COUNTERS_H
+
+// Operation counters for the complexity harness in fuzz/. They count
+// characters scanned or copied and comparisons made while parsing and
+// rendering, and compile to nothing unless CODA_FORMAT_COUNT_OPERATIONS
+// is defined.
+
+#ifdef CODA_FORMAT_COUNT_OPERATIONS
+
+#include <cstdint>
+
+namespace coda
+{
+    namespace detail
+    {
+        struct operation_counters {
+            std::uint64_t parse;
+            std::uint64_t render;
+        };
+
+        extern thread_local operation_counters counters;
+    }
+}
+
+#define CODA_COUNT_PARSE(n) (::coda::detail::counters.parse += static_cast<std::uint64_t>(n))
+#define CODA_COUNT_RENDER(n) (::coda::detail::counters.render += static_cast<std::uint64_t>(n))
+
+#else
+
+#define CODA_COUNT_PARSE(n) ((void)0)
+#define CODA_COUNT_RENDER(n) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+/*!
+ * implementation of the capture reader
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/decoder.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace coda
+{
+    capture_reader::capture_reader(const std::string &path) : map_(nullptr), length_(0), end_(0), pos_(0), templates_()
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error("unable to open capture file");
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) == -1) {
+            ::close(fd);
+            throw std::runtime_error("unable to open capture file");
+        }
+
+        length_ = static_cast<std::size_t>(info.st_size);
+
+        if (length_ < sizeof(capture::header)) {
+            ::close(fd);
+            throw std::invalid_argument("invalid capture file");
+        }
+
+        void *map = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("unable to map capture file");
+        }
+
+        map_ = static_cast<const char *>(map);
+
+        capture::header header;
+        std::memcpy(&header, map_, sizeof(header));
+
+        // pairs with the release store of the writer, for a file still being written
+        header.used = __atomic_load_n(reinterpret_cast<const std::uint64_t *>(map_ + offsetof(capture::header, used)),
+                                      __ATOMIC_ACQUIRE);
+
+        if (std::memcmp(header.magic, capture::magic, sizeof(header.magic)) != 0 ||
+            header.version != capture::version || header.byte_order != capture::byte_order ||
+            header.used > length_ - sizeof(header)) {
+            ::munmap(const_cast<char *>(map_), length_);
+            throw std::invalid_argument("invalid capture file");
+        }
+
+        pos_ = sizeof(header);
+        end_ = sizeof(header) + static_cast<std::size_t>(header.used);
+    }
+
+    capture_reader::~capture_reader()
+    {
+        ::munmap(const_cast<char *>(map_), length_);
+    }
+
+    const char *capture_reader::read(std::size_t length)
+    {
+        if (length > end_ - pos_) {
+            throw std::invalid_argument("truncated capture record");
+        }
+
+        const char *value = map_ + pos_;
+        pos_ += length;
+        return value;
+    }
+
+    template <typename T>
+    T capture_reader::read_value()
+    {
+        T value;
+        std::memcpy(&value, read(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    void capture_reader::decode_argument(format &record)
+    {
+        switch (read_value<std::uint8_t>()) {
+            case capture::boolean_tag:
+                record.args(read_value<char>() != 0);
+                break;
+            case capture::character_tag:
+                record.args(read_value<char>());
+                break;
+            case capture::int16_tag:
+                record.args(read_value<std::int16_t>());
+                break;
+            case capture::uint16_tag:
+                record.args(read_value<std::uint16_t>());
+                break;
+            case capture::int32_tag:
+                record.args(read_value<std::int32_t>());
+                break;
+            case capture::uint32_tag:
+                record.args(read_value<std::uint32_t>());
+                break;
+            case capture::int64_tag:
+                record.args(read_value<std::int64_t>());
+                break;
+            case capture::uint64_tag:
+                record.args(read_value<std::uint64_t>());
+                break;
+            case capture::float64_tag:
+                record.args(read_value<double>());
+                break;
+            case capture::string_tag: {
+                const auto length = read_value<std::uint32_t>();
+                record.args(std::string(read(length), length));
+                break;
+            }
+            default:
+                throw std::invalid_argument("invalid capture argument");
+        }
+    }
+
+    bool capture_reader::next(std::string &out)
+    {
+        while (pos_ < end_) {
+            const auto entry = read_value<std::uint8_t>();
+            const auto id = read_value<std::uint32_t>();
+
+            if (entry == capture::define_entry) {
+                if (id != templates_.size()) {
+                    throw std::invalid_argument("invalid capture template");
+                }
+
+                const auto length = read_value<std::uint32_t>();
+                templates_.emplace_back(std::string(read(length), length));
+                continue;
+            }
+
+            if (entry != capture::record_entry || id >= templates_.size()) {
+                throw std::invalid_argument("invalid capture record");
+            }
+
+            format record(templates_[id]);
+
+            const auto count = read_value<std::uint8_t>();
+            for (std::uint8_t i = 0; i < count; ++i) {
+                decode_argument(record);
+            }
+
+            out = record.str();
+            return true;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,144 @@
+/*!
+ * implementation of the dynamic argument store
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/dynamic_args.h>
+
+#include <vector>
+
+namespace coda
+{
+    dynamic_args::dynamic_args() : tags_(), values_(), strings_()
+    {
+    }
+
+    void dynamic_args::reserve(std::size_t count, std::size_t string_bytes)
+    {
+        tags_.reserve(count);
+        values_.reserve(count);
+        strings_.reserve(string_bytes);
+    }
+
+    std::size_t dynamic_args::size() const
+    {
+        return tags_.size();
+    }
+
+    bool dynamic_args::empty() const
+    {
+        return tags_.empty();
+    }
+
+    void dynamic_args::add(capture::tag tag, std::uint64_t bits)
+    {
+        tags_.push_back(tag);
+
+        try {
+            values_.push_back(bits);
+        } catch (...) {
+            tags_.pop_back();
+            throw;
+        }
+    }
+
+    void dynamic_args::clear()
+    {
+        tags_.clear();
+        values_.clear();
+        strings_.clear();
+    }
+
+    format &format::args(const dynamic_args &values)
+    {
+        // checked first so a failed call binds nothing
+        if (values.size() > arguments_ - cursor_) {
+            throw std::invalid_argument("no specifier for argument");
+        }
+
+        const auto first = cursor_;
+        const auto unbound = unbound_;
+
+        // the specifiers of arguments already bound by arg(), restored if a later argument fails
+        std::vector<specifier> saved;
+
+        try {
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                const auto bits = values.values_[i];
+
+                if (specifiers_[cursor_].bound) {
+                    for (auto slot = cursor_; slot != npos; slot = specifiers_[slot].repeat) {
+                        saved.push_back(specifiers_[slot]);
+                    }
+                }
+
+                switch (values.tags_[i]) {
+                    case capture::boolean_tag:
+                        bind_argument(cursor_, bits != 0);
+                        break;
+                    case capture::character_tag:
+                        bind_argument(cursor_, static_cast<char>(bits));
+                        break;
+                    case capture::int16_tag:
+                        bind_argument(cursor_, static_cast<std::int16_t>(bits));
+                        break;
+                    case capture::uint16_tag:
+                        bind_argument(cursor_, static_cast<std::uint16_t>(bits));
+                        break;
+                    case capture::int32_tag:
+                        bind_argument(cursor_, static_cast<std::int32_t>(bits));
+                        break;
+                    case capture::uint32_tag:
+                        bind_argument(cursor_, static_cast<std::uint32_t>(bits));
+                        break;
+                    case capture::int64_tag:
+                        bind_argument(cursor_, static_cast<std::int64_t>(bits));
+                        break;
+                    case capture::uint64_tag:
+                        bind_argument(cursor_, bits);
+                        break;
+                    case capture::float64_tag: {
+                        double value;
+                        std::memcpy(&value, &bits, sizeof(value));
+                        bind_argument(cursor_, value);
+                        break;
+                    }
+                    case capture::string_tag:
+                        bind_argument(cursor_, std::string_view(values.strings_.data() + (bits >> 32),
+                                                                static_cast<std::uint32_t>(bits)));
+                        break;
+                }
+
+                ++cursor_;
+            }
+        } catch (...) {
+            // a failed call binds nothing, so every argument it reached is unbound or restored
+            auto restore = saved.begin();
+
+            for (auto index = first; index <= cursor_ && index < arguments_; ++index) {
+                const bool was_bound = restore != saved.end() && restore->index == index;
+
+                for (auto slot = index; slot != npos; slot = specifiers_[slot].repeat) {
+                    auto &spec = specifiers_[slot];
+
+                    if (was_bound) {
+                        // a slot not saved was never bound again
+                        if (restore != saved.end() && restore->index == index) {
+                            spec = *restore++;
+                        }
+                    } else {
+                        spec.replacement.clear();
+                        spec.bound = false;
+                    }
+                    spec.dirty = true;
+                }
+            }
+
+            cursor_ = first;
+            unbound_ = unbound;
+            throw;
+        }
+
+        return *this;
+    }
+}
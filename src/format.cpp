@@ -4,26 +4,37 @@
  */
 
 #include "format.h"
+#include "counters.h"
+#include "kernels.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <cstdlib>
-#include <iomanip>
-#include <iterator>
+#include <cstring>
 #include <limits>
+#include <locale>
+#include <unordered_map>
 #include <utility>
 
+// the hash seeds tried for the name table before falling back to sorted names
+#ifndef CODA_FORMAT_NAME_SEEDS
+#define CODA_FORMAT_NAME_SEEDS 16
+#endif
+
 namespace
 {
-    int parse_decimal_token(const std::string &token, bool allow_negative, const char *error)
+    bool parse_decimal_token(std::string_view token, bool allow_negative, int &result)
     {
         if (token.empty()) {
-            throw std::invalid_argument(error);
+            return false;
         }
 
         std::size_t position = 0;
         bool negative = false;
         if (token[0] == '-') {
             if (!allow_negative || token.size() == 1) {
-                throw std::invalid_argument(error);
+                return false;
             }
             negative = true;
             position = 1;
@@ -33,304 +44,833 @@ namespace
         for (; position < token.size(); ++position) {
             const char ch = token[position];
             if (ch < '0' || ch > '9') {
-                throw std::invalid_argument(error);
+                return false;
             }
 
             const int digit = ch - '0';
             if (value > (std::numeric_limits<int>::max() - digit) / 10) {
-                throw std::invalid_argument(error);
+                return false;
             }
             value = value * 10 + digit;
         }
 
-        return negative ? -value : value;
+        result = negative ? -value : value;
+        return true;
     }
 
-    std::size_t parse_index_token(const std::string &token)
+    bool parse_precision_token(std::string_view token, int &value)
     {
-        return static_cast<std::size_t>(
-            parse_decimal_token(token, false, "invalid specifier format"));
+        // bounded like width so a short specifier cannot request unbounded output
+        return parse_decimal_token(token, false, value) && value <= std::numeric_limits<std::int8_t>::max();
     }
 
-    std::int8_t parse_width_token(const std::string &token)
+    // sub-second digits and an optional offset from UTC, as in t3, t+0530 or t6-0800
+    bool parse_time_token(std::string_view token, int &digits, bool &has_zone, int &zone)
     {
-        const int value = parse_decimal_token(token, true, "invalid specifier format");
-        if (value < std::numeric_limits<std::int8_t>::min() ||
-            value > std::numeric_limits<std::int8_t>::max()) {
-            throw std::invalid_argument("invalid specifier format");
+        has_zone = false;
+
+        std::size_t position = 0;
+        if (position < token.size() && token[position] >= '0' && token[position] <= '9') {
+            digits = token[position++] - '0';
+        }
+
+        if (position == token.size()) {
+            return true;
+        }
+
+        const auto offset = token.substr(position);
+        if (offset.size() != 5 || (offset[0] != '+' && offset[0] != '-')) {
+            return false;
+        }
+
+        int hours = 0;
+        int minutes = 0;
+        if (!parse_decimal_token(offset.substr(1, 2), false, hours) ||
+            !parse_decimal_token(offset.substr(3, 2), false, minutes) || hours > 23 || minutes > 59) {
+            return false;
         }
-        return static_cast<std::int8_t>(value);
+
+        has_zone = true;
+        zone = (hours * 60 + minutes) * (offset[0] == '-' ? -1 : 1);
+        return true;
     }
 
-    int parse_precision_token(const std::string &token)
+    bool is_name_start(char ch)
     {
-        return parse_decimal_token(token, false, "invalid precision format for argument");
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
     }
-}
 
-namespace coda
-{
-    format::format(const std::string &str) : value_(str), specifiers_(), currentSpecifier_(specifiers_.begin())
+    bool is_name_token(std::string_view token)
     {
-        initialize();
+        for (const char ch : token) {
+            if (!is_name_start(ch) && (ch < '0' || ch > '9')) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    format::~format()
+    using parse_error = coda::format::parse_error;
+
+    // the fields of a specifier, as views of the format string
+    struct specifier_fields {
+        std::string_view name;    // empty for a positional specifier
+        std::size_t index;        // the argument index of a positional specifier
+        int width;                // zero without a width
+        char escape;              // the escaping mode, or zero without one
+        std::string_view format;  // the type and its argument, empty without a type
+    };
+
+    // splits the text between the tags of a specifier without allocating.
+    // on error, offset is the position of the error in the token.
+    parse_error parse_specifier(std::string_view token, specifier_fields &fields, std::size_t &offset)
+    {
+        fields.name = std::string_view();
+        fields.index = 0;
+        fields.width = 0;
+        fields.escape = '\0';
+        fields.format = std::string_view();
+
+        auto index_and_width = token;
+
+        const auto colon = token.find(':');
+        if (colon != std::string_view::npos) {
+            const auto second = token.find(':', colon + 1);
+            if (second != std::string_view::npos) {
+                offset = second;
+                return parse_error::invalid_specifier;
+            }
+
+            index_and_width = token.substr(0, colon);
+            fields.format = token.substr(colon + 1);
+            if (fields.format.empty()) {
+                offset = colon;
+                return parse_error::invalid_specifier;
+            }
+        }
+
+        // an escaping mode ends the index and width, as in {0,8!j}
+        const auto bang = index_and_width.find('!');
+        if (bang != std::string_view::npos) {
+            offset = bang;
+            if (bang + 2 != index_and_width.size()) {
+                return parse_error::invalid_escape;
+            }
+
+            fields.escape = index_and_width[bang + 1];
+            if (fields.escape != 'n' && fields.escape != 'j' && fields.escape != 'h' && fields.escape != 'c') {
+                return parse_error::invalid_escape;
+            }
+
+            index_and_width = index_and_width.substr(0, bang);
+        }
+
+        auto index_token = index_and_width;
+        std::string_view width_token;
+        std::size_t width_offset = 0;
+        bool has_width = false;
+
+        const auto canonical_comma = index_and_width.find(',');
+        if (canonical_comma != std::string_view::npos) {
+            const auto second = index_and_width.find(',', canonical_comma + 1);
+            if (second != std::string_view::npos) {
+                offset = second;
+                return parse_error::invalid_specifier;
+            }
+
+            index_token = index_and_width.substr(0, canonical_comma);
+            width_token = index_and_width.substr(canonical_comma + 1);
+            width_offset = canonical_comma + 1;
+            has_width = true;
+        }
+
+        if (!fields.format.empty()) {
+            const auto compatibility_comma = fields.format.find(',');
+            if (compatibility_comma != std::string_view::npos) {
+                offset = colon + 1 + compatibility_comma;
+                if (fields.format.find(',', compatibility_comma + 1) != std::string_view::npos || has_width ||
+                    compatibility_comma == 0) {
+                    return parse_error::invalid_specifier;
+                }
+
+                width_token = fields.format.substr(compatibility_comma + 1);
+                width_offset = offset + 1;
+                fields.format = fields.format.substr(0, compatibility_comma);
+                has_width = true;
+            }
+        }
+
+        offset = 0;
+        if (!index_token.empty() && is_name_start(index_token[0])) {
+            if (!is_name_token(index_token)) {
+                return parse_error::invalid_name;
+            }
+            fields.name = index_token;
+        } else {
+            int index = 0;
+            if (!parse_decimal_token(index_token, false, index)) {
+                return parse_error::invalid_index;
+            }
+            fields.index = static_cast<std::size_t>(index);
+        }
+
+        if (has_width) {
+            offset = width_offset;
+            if (!parse_decimal_token(width_token, true, fields.width)) {
+                return parse_error::invalid_width;
+            }
+            if (fields.width < std::numeric_limits<std::int8_t>::min() ||
+                fields.width > std::numeric_limits<std::int8_t>::max()) {
+                return parse_error::width_out_of_range;
+            }
+        }
+
+        return parse_error::none;
+    }
+
+    // hashes for the perfect hash of specifier names
+    std::uint64_t mix_hash(std::uint64_t value)
     {
-        // specifiers_.clear();
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
     }
 
-    format::format(const format &other) : value_(other.value_), specifiers_(), currentSpecifier_(specifiers_.begin())
+    std::uint64_t hash_name(const char *name, std::size_t length, std::uint64_t seed)
     {
-        for (auto s : other.specifiers_) {
-            specifiers_.push_back(s);
+        std::uint64_t value = 0xcbf29ce484222325ULL ^ mix_hash(seed);
+        for (std::size_t i = 0; i < length; ++i) {
+            value ^= static_cast<unsigned char>(name[i]);
+            value *= 0x100000001b3ULL;
         }
+        return value;
+    }
 
-        currentSpecifier_ = specifiers_.begin();
-        std::advance(currentSpecifier_,
-                     std::distance(other.specifiers_.begin(), SpecifierList::const_iterator(other.currentSpecifier_)));
+    std::uint64_t displace_hash(std::uint64_t hash, std::uint32_t displacement)
+    {
+        return mix_hash(hash ^ (displacement * 0x9e3779b97f4a7c15ULL));
     }
 
-    format::format(format &&other)
-        : value_(std::move(other.value_)),
-          specifiers_(std::move(other.specifiers_)),
-          currentSpecifier_(std::move(other.currentSpecifier_))
+    std::size_t power_of_two(std::size_t value)
     {
-        other.specifiers_.clear();
-        other.currentSpecifier_ = other.specifiers_.begin();
+        std::size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
     }
 
-    format &format::operator=(const format &rhs)
+    // two digit lookup, so integers convert a digit pair per division
+    const char decimal_pairs[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    char *write_decimal(char *end, std::uint64_t value)
     {
-        value_ = rhs.value_;
-        specifiers_.clear();
+        while (value >= 100) {
+            const auto pair = static_cast<std::size_t>(value % 100) * 2;
+            value /= 100;
+            *--end = decimal_pairs[pair + 1];
+            *--end = decimal_pairs[pair];
+        }
 
-        for (auto s : rhs.specifiers_) {
-            specifiers_.push_back(s);
+        if (value >= 10) {
+            const auto pair = static_cast<std::size_t>(value) * 2;
+            *--end = decimal_pairs[pair + 1];
+            *--end = decimal_pairs[pair];
+        } else {
+            *--end = static_cast<char>('0' + value);
         }
 
-        currentSpecifier_ = specifiers_.begin();
-        std::advance(currentSpecifier_,
-                     std::distance(rhs.specifiers_.begin(), SpecifierList::const_iterator(rhs.currentSpecifier_)));
+        return end;
+    }
 
-        return *this;
+    char *write_pair(char *pos, unsigned value)
+    {
+        pos[0] = decimal_pairs[value * 2];
+        pos[1] = decimal_pairs[value * 2 + 1];
+        return pos + 2;
     }
 
-    format &format::operator=(format &&rhs)
+    // the proleptic gregorian date of a day count from 1970-01-01
+    void civil_from_days(std::int64_t days, std::int64_t &year, unsigned &month, unsigned &day)
     {
-        value_ = std::move(rhs.value_);
-        specifiers_ = std::move(rhs.specifiers_);
-        currentSpecifier_ = std::move(rhs.currentSpecifier_);
+        days += 719468;
+        const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const auto day_of_era = static_cast<unsigned>(days - era * 146097);
+        const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+        const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+        const unsigned shifted_month = (5 * day_of_year + 2) / 153;
+
+        day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+        month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+        year = static_cast<std::int64_t>(year_of_era) + era * 400 + (month <= 2 ? 1 : 0);
+    }
 
-        rhs.specifiers_.clear();
-        rhs.currentSpecifier_ = rhs.specifiers_.begin();
+    // the date and time of the last second a thread rendered, so the
+    // timestamps within one second only convert their fraction
+    struct time_cache {
+        std::int64_t days = std::numeric_limits<std::int64_t>::min();
+        std::int64_t second = 0;
+        std::size_t length = 0;
+        char prefix[40];  // as 2024-05-01T12:34:56
+    };
 
-        return *this;
-    }
+    thread_local time_cache last_time;
 
-    std::size_t format::specifiers() const
+    const time_cache &render_time_prefix(std::int64_t days, std::int64_t second)
     {
-        return specifiers_.size() -
-               std::distance(specifiers_.begin(), SpecifierList::const_iterator(currentSpecifier_));
+        auto &cache = last_time;
+        if (cache.days == days && cache.second == second) {
+            return cache;
+        }
+
+        std::int64_t year = 0;
+        unsigned month = 0;
+        unsigned day = 0;
+        civil_from_days(days, year, month, day);
+
+        char *pos = cache.prefix;
+
+        if (year >= 0 && year <= 9999) {
+            pos = write_pair(pos, static_cast<unsigned>(year / 100));
+            pos = write_pair(pos, static_cast<unsigned>(year % 100));
+        } else {
+            // the expanded form for years outside four digits
+            char digits[24];
+            char *end = digits + sizeof(digits);
+            const auto magnitude = year < 0 ? 0 - static_cast<std::uint64_t>(year) : static_cast<std::uint64_t>(year);
+            const char *start = write_decimal(end, magnitude);
+
+            *pos++ = year < 0 ? '-' : '+';
+            std::memcpy(pos, start, static_cast<std::size_t>(end - start));
+            pos += end - start;
+        }
+
+        const auto seconds = static_cast<unsigned>(second);
+
+        *pos++ = '-';
+        pos = write_pair(pos, month);
+        *pos++ = '-';
+        pos = write_pair(pos, day);
+        *pos++ = 'T';
+        pos = write_pair(pos, seconds / 3600);
+        *pos++ = ':';
+        pos = write_pair(pos, seconds / 60 % 60);
+        *pos++ = ':';
+        pos = write_pair(pos, seconds % 60);
+
+        cache.days = days;
+        cache.second = second;
+        cache.length = static_cast<std::size_t>(pos - cache.prefix);
+
+        return cache;
     }
 
-    void format::add_specifier(std::string::size_type start, std::string::size_type end)
-    {
-        const std::string token = value_.substr(start, end - start);
+    // output sinks sharing the render program
+    struct string_sink {
+        std::string &out;
 
-        specifier spec;
-        spec.index = 0;
-        spec.prev = start - 1;
-        spec.next = end + 1;
-        spec.width = 0;
-        spec.type = '\0';
+        void append(const char *value, std::size_t length)
+        {
+            out.append(value, length);
+        }
+    };
 
-        std::string index_and_width = token;
-        std::string format_token;
+    struct stream_sink {
+        std::ostream &out;
 
-        const auto colon = token.find(':');
-        if (colon != std::string::npos) {
-            if (token.find(':', colon + 1) != std::string::npos) {
-                throw std::invalid_argument("invalid specifier format");
-            }
+        void append(const char *value, std::size_t length)
+        {
+            out.write(value, static_cast<std::streamsize>(length));
+        }
+    };
 
-            index_and_width = token.substr(0, colon);
-            format_token = token.substr(colon + 1);
-            if (format_token.empty()) {
-                throw std::invalid_argument("invalid specifier format");
+    struct buffer_sink {
+        char *buffer;
+        std::size_t size;
+        std::size_t length;
+
+        void append(const char *value, std::size_t count)
+        {
+            if (length < size) {
+                std::memcpy(buffer + length, value, std::min(count, size - length));
             }
+            length += count;
         }
+    };
 
-        std::string index_token = index_and_width;
-        std::string width_token;
-        bool has_width = false;
+    // appends count copies of a fill character
+    template <typename Sink>
+    void append_fill(Sink &out, char fill, std::size_t count)
+    {
+        char buf[64];
+        std::memset(buf, fill, std::min(count, sizeof(buf)));
 
-        const auto canonical_comma = index_and_width.find(',');
-        if (canonical_comma != std::string::npos) {
-            if (index_and_width.find(',', canonical_comma + 1) != std::string::npos) {
-                throw std::invalid_argument("invalid specifier format");
-            }
+        while (count > 0) {
+            const auto length = std::min(count, sizeof(buf));
+            out.append(buf, length);
+            count -= length;
+        }
+    }
 
-            index_token = index_and_width.substr(0, canonical_comma);
-            width_token = index_and_width.substr(canonical_comma + 1);
-            has_width = true;
+    // the width of a value in a unit
+    std::size_t width_in(coda::format::width_unit unit, const char *value, std::size_t length)
+    {
+        if (unit == coda::format::width_unit::bytes) {
+            return length;
         }
 
-        if (!format_token.empty()) {
-            const auto compatibility_comma = format_token.find(',');
-            if (compatibility_comma != std::string::npos) {
-                if (format_token.find(',', compatibility_comma + 1) != std::string::npos || has_width) {
-                    throw std::invalid_argument("invalid specifier format");
-                }
+        return coda::kernels::utf8_width(value, length, unit == coda::format::width_unit::columns);
+    }
 
-                width_token = format_token.substr(compatibility_comma + 1);
-                format_token = format_token.substr(0, compatibility_comma);
-                has_width = true;
+    // a stream buffer appending directly to a string
+    class string_buffer : public std::streambuf
+    {
+       public:
+        void target(std::pmr::string *out)
+        {
+            out_ = out;
+        }
 
-                if (format_token.empty()) {
-                    throw std::invalid_argument("invalid specifier format");
-                }
+       protected:
+        int_type overflow(int_type ch) override
+        {
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                out_->push_back(traits_type::to_char_type(ch));
             }
+            return traits_type::not_eof(ch);
         }
 
-        spec.index = parse_index_token(index_token);
-        if (has_width) {
-            spec.width = parse_width_token(width_token);
+        std::streamsize xsputn(const char *s, std::streamsize count) override
+        {
+            out_->append(s, static_cast<std::size_t>(count));
+            return count;
         }
 
-        if (!format_token.empty()) {
-            spec.type = format_token[0];
-            spec.format = format_token.substr(1);
+       private:
+        std::pmr::string *out_ = nullptr;
+    };
+}
+
+namespace coda
+{
+#ifdef CODA_FORMAT_COUNT_OPERATIONS
+    namespace detail
+    {
+        thread_local operation_counters counters = {0, 0};
+    }
+#endif
+
+    struct format::argument_stream::state {
+        string_buffer buffer;
+        std::ostream stream{&buffer};
+        bool in_use = false;
+    };
+
+    format::argument_stream::argument_stream(std::pmr::string &out) : state_(nullptr), owned_(false)
+    {
+        static thread_local state shared;
+
+        state_ = &shared;
+        if (state_->in_use) {
+            state_ = new state();
+            owned_ = true;
         }
 
-        specifiers_.push_back(spec);
+        state_->in_use = true;
+        state_->buffer.target(&out);
+
+        // formatting from a previous argument must not leak into this one
+        auto &stream = state_->stream;
+        stream.clear();
+        stream.flags(std::ios_base::skipws | std::ios_base::dec);
+        stream.fill(' ');
+        stream.precision(6);
+        stream.width(0);
+
+        // as a new stream would, for a global locale changed since the last use
+        const std::locale global;
+        if (stream.getloc() != global) {
+            stream.imbue(global);
+        }
     }
 
-    void format::initialize()
+    format::argument_stream::~argument_stream()
     {
-        auto len = value_.length();
+        state_->buffer.target(nullptr);
+        state_->in_use = false;
 
-        for (std::size_t pos = 0; pos < len; pos++) {
-            if (value_[pos] != s_open_tag) {
-                continue;
-            }
+        if (owned_) {
+            delete state_;
+        }
+    }
 
-            if (++pos >= len) break;
+    std::ostream &format::argument_stream::stream()
+    {
+        return state_->stream;
+    }
 
-            if (pos < len && value_[pos] == s_open_tag) {
-                continue;
-            }
+    format::format() : format(std::string_view(), std::pmr::new_delete_resource(), false)
+    {
+    }
 
-            auto end = value_.find(s_close_tag, pos);
-            if (end == std::string::npos) {
-                throw std::invalid_argument("no specifier closing tag");
-            }
+    format::format(const std::string &str) : format(std::string_view(str), std::pmr::new_delete_resource(), true)
+    {
+    }
+
+    format::format(std::string_view str, std::pmr::memory_resource *resource) : format(str, resource, true)
+    {
+    }
 
-            add_specifier(pos, end);
+    format::format(std::string_view str, std::pmr::memory_resource *resource, bool parse)
+        : value_(str, resource),
+          literals_(resource),
+          specifiers_(resource),
+          program_(resource),
+          arguments_(0),
+          cursor_(0),
+          unbound_(0),
+          names_(resource),
+          displacements_(resource),
+          seed_(0),
+          rendered_(resource),
+          segments_(resource),
+          refreshed_(false),
+          escape_(escaping::none),
+          measure_(width_unit::bytes),
+          referenced_(false)
+    {
+        if (parse) {
+            initialize();
         }
+    }
 
-        if (specifiers_.empty()) {
-            return;
+    format::~format()
+    {
+    }
+
+    format::format(const format &other) : format(other, std::pmr::new_delete_resource())
+    {
+    }
+
+    format::format(const format &other, std::pmr::memory_resource *resource)
+        : value_(other.value_, resource),
+          literals_(other.literals_, resource),
+          specifiers_(other.specifiers_, resource),
+          program_(other.program_, resource),
+          arguments_(other.arguments_),
+          cursor_(other.cursor_),
+          unbound_(other.unbound_),
+          names_(other.names_, resource),
+          displacements_(other.displacements_, resource),
+          seed_(other.seed_),
+          rendered_(other.rendered_, resource),
+          segments_(other.segments_, resource),
+          refreshed_(other.refreshed_),
+          escape_(other.escape_),
+          measure_(other.measure_),
+          referenced_(false)
+    {
+    }
+
+    format::format(format &&other)
+        : value_(std::move(other.value_), std::pmr::new_delete_resource()),
+          literals_(std::move(other.literals_), std::pmr::new_delete_resource()),
+          specifiers_(std::move(other.specifiers_), std::pmr::new_delete_resource()),
+          program_(std::move(other.program_), std::pmr::new_delete_resource()),
+          arguments_(other.arguments_),
+          cursor_(other.cursor_),
+          unbound_(other.unbound_),
+          names_(std::move(other.names_), std::pmr::new_delete_resource()),
+          displacements_(std::move(other.displacements_), std::pmr::new_delete_resource()),
+          seed_(other.seed_),
+          rendered_(std::move(other.rendered_), std::pmr::new_delete_resource()),
+          segments_(std::move(other.segments_), std::pmr::new_delete_resource()),
+          refreshed_(other.refreshed_),
+          escape_(other.escape_),
+          measure_(other.measure_),
+          referenced_(false)
+    {
+        other.clear_moved();
+    }
+
+    format &format::operator=(const format &rhs)
+    {
+        if (this == &rhs) {
+            return *this;
         }
 
-        specifiers_.sort([&](const specifier &first, const specifier &second) { return first.index < second.index; });
-        currentSpecifier_ = specifiers_.begin();
+        // nothing shows a format never bound by reference, so rhs cannot show this one
+        if (!referenced_ || !rhs.refers_to(this)) {
+            assign(rhs);
+            return *this;
+        }
 
-        std::size_t index = 0;
-        for (auto spec : specifiers_) {
-            if (spec.index != index++) {
-                throw std::invalid_argument("specifier index not ordered");
-            }
+        // rendered from a copy while this is unchanged, so the output is what rhs shows now
+        format copy(rhs);
+        copy.detach_from(this);
+        assign(copy);
+
+        return *this;
+    }
+
+    format &format::operator=(format &&rhs)
+    {
+        if (this == &rhs) {
+            return *this;
         }
+
+        if (referenced_) {
+            rhs.detach_from(this);
+        }
+
+        value_ = std::move(rhs.value_);
+        literals_ = std::move(rhs.literals_);
+        specifiers_ = std::move(rhs.specifiers_);
+        program_ = std::move(rhs.program_);
+        arguments_ = rhs.arguments_;
+        cursor_ = rhs.cursor_;
+        unbound_ = rhs.unbound_;
+        names_ = std::move(rhs.names_);
+        displacements_ = std::move(rhs.displacements_);
+        seed_ = rhs.seed_;
+        rendered_ = std::move(rhs.rendered_);
+        segments_ = std::move(rhs.segments_);
+        refreshed_ = rhs.refreshed_;
+        escape_ = rhs.escape_;
+        measure_ = rhs.measure_;
+
+        rhs.clear_moved();
+
+        return *this;
     }
 
-    void format::begin_manip(std::ostream &out, const specifier &arg) const
+    void format::assign(const format &rhs)
     {
-        if (arg.width != 0) {
-            out << std::setw(std::abs(arg.width));
-            if (arg.width < 0) {
-                out << std::left;
-            }
+        value_ = rhs.value_;
+        literals_ = rhs.literals_;
+        specifiers_ = rhs.specifiers_;
+        program_ = rhs.program_;
+        arguments_ = rhs.arguments_;
+        cursor_ = rhs.cursor_;
+        unbound_ = rhs.unbound_;
+        names_ = rhs.names_;
+        displacements_ = rhs.displacements_;
+        seed_ = rhs.seed_;
+        rendered_ = rhs.rendered_;
+        segments_ = rhs.segments_;
+        refreshed_ = rhs.refreshed_;
+        escape_ = rhs.escape_;
+        measure_ = rhs.measure_;
+    }
+
+    void format::clear_moved()
+    {
+        // a moved from format is left empty, whether its storage was taken or copied
+        value_.clear();
+        literals_.clear();
+        specifiers_.clear();
+        program_.clear();
+        names_.clear();
+        displacements_.clear();
+        rendered_.clear();
+        segments_.clear();
+        arguments_ = cursor_ = unbound_ = 0;
+        refreshed_ = false;
+    }
+
+    std::size_t format::specifiers() const
+    {
+        return unbound_;
+    }
+
+    void format::add_specifier(std::string::size_type start, std::string::size_type end)
+    {
+        const auto token = std::string_view(value_).substr(start, end - start);
+
+        CODA_COUNT_PARSE(token.size());
+
+        // the format string was validated, so the fields always parse
+        specifier_fields fields;
+        std::size_t error_offset = 0;
+        parse_specifier(token, fields, error_offset);
+
+        specifier spec(specifiers_.get_allocator());
+        spec.start = start - 1;
+        spec.length = end - start + 2;
+        spec.index = fields.index;
+        spec.name = start;
+        spec.name_length = fields.name.size();
+        spec.repeat = npos;
+        spec.bound = false;
+        spec.dirty = false;
+        spec.width = static_cast<std::int8_t>(fields.width);
+        spec.type = '\0';
+        spec.convert = conversion::general;
+        spec.uppercase = false;
+        spec.newline = false;
+        spec.fill = ' ';
+        spec.padding = 0;
+        spec.precision = 6;
+        spec.group = 0;
+        spec.separator = ' ';
+        spec.zone = utc_zone;
+        spec.nested = nullptr;
+        spec.escape = escaping::none;
+        spec.inherit = fields.escape == '\0';
+
+        switch (fields.escape) {
+            case 'j':
+                spec.escape = escaping::json;
+                break;
+            case 'h':
+                spec.escape = escaping::html;
+                break;
+            case 'c':
+                spec.escape = escaping::csv;
+                break;
         }
 
-        if (arg.type == '\0') {
-            return;
+        if (!fields.format.empty()) {
+            spec.type = fields.format[0];
+            spec.format = fields.format.substr(1);
         }
 
-        switch (arg.type) {
+        // decode the type once so binding does not interpret it
+        switch (spec.type) {
             case 'E':
-                out << std::uppercase;
+                spec.uppercase = true;
+                // fall through
             case 'e':
-                if (!arg.format.empty()) {
-                    out << std::setprecision(parse_precision_token(arg.format));
-                } else {
-                    out << std::setprecision(9);
-                }
-                out << std::scientific;
+                spec.convert = conversion::scientific;
                 break;
             case 'F':
             case 'f':
-                if (!arg.format.empty()) {
-                    out << std::setprecision(parse_precision_token(arg.format));
-                } else {
-                    out << std::setprecision(9);
-                }
-                out << std::fixed;
+                spec.convert = conversion::fixed;
                 break;
             case 'X':
-                out << std::uppercase;
+                spec.uppercase = true;
+                // fall through
             case 'x':
-                out << std::hex << std::setfill('0');
-                if (arg.width == 0) {
-                    out << std::setw(2);
-                }
+                spec.convert = conversion::hex;
+                spec.fill = '0';
                 break;
             case 'O':
             case 'o':
-                out << std::oct;
+                spec.convert = conversion::oct;
+                break;
+            case 'n':
+                spec.newline = true;
+                break;
+            case 'H':
+                spec.uppercase = true;
+                // fall through
+            case 'h':
+                spec.convert = conversion::dump;
+                break;
+            case 't':
+                spec.convert = conversion::time;
+                spec.precision = 0;
                 break;
         }
-    }
 
-    void format::end_manip(std::ostream &out, const specifier &arg)
-    {
-        switch (arg.type) {
-            case 'x':
-            case 'X':
-                out << std::dec;
+        if (spec.convert == conversion::time && !spec.format.empty()) {
+            bool has_zone = false;
+            int zone = 0;
+            if (!parse_time_token(spec.format, spec.precision, has_zone, zone)) {
+                // reported when an argument is bound
+                spec.convert = conversion::invalid;
+            } else if (has_zone) {
+                spec.zone = static_cast<std::int16_t>(zone);
+            }
+        }
+
+        if (spec.convert == conversion::dump && !spec.format.empty()) {
+            // a group size and an optional separator, as in h4 or h1-
+            auto digits = spec.format.find_first_not_of("0123456789");
+            if (digits == std::string::npos) {
+                digits = spec.format.size();
+            }
+
+            int group = 0;
+            if (digits == 0 || spec.format.size() - digits > 1 ||
+                !parse_precision_token(spec.format.substr(0, digits), group)) {
+                // reported when an argument is bound
+                spec.convert = conversion::invalid;
+            } else {
+                spec.group = static_cast<std::uint8_t>(group);
+                if (digits < spec.format.size()) {
+                    spec.separator = spec.format[digits];
+                }
+            }
+        }
+
+        if (spec.convert == conversion::fixed || spec.convert == conversion::scientific) {
+            if (spec.format.empty()) {
+                spec.precision = 9;
+            } else if (!parse_precision_token(spec.format, spec.precision)) {
+                // reported when an argument is bound
+                spec.convert = conversion::invalid;
+            }
+        }
+
+        spec.padding = static_cast<std::uint8_t>(std::abs(spec.width));
+        if (spec.convert == conversion::hex && spec.width == 0) {
+            spec.padding = 2;
+        }
+
+        spec.flags = std::ios_base::skipws;
+        switch (spec.convert) {
+            case conversion::hex:
+                spec.flags |= std::ios_base::hex;
                 break;
-            case 'n':
-                out << std::endl;
+            case conversion::oct:
+                spec.flags |= std::ios_base::oct;
+                break;
+            case conversion::fixed:
+                spec.flags |= std::ios_base::dec | std::ios_base::fixed;
+                break;
+            case conversion::scientific:
+                spec.flags |= std::ios_base::dec | std::ios_base::scientific;
+                break;
+            default:
+                spec.flags |= std::ios_base::dec;
                 break;
         }
-    }
+        if (spec.uppercase) {
+            spec.flags |= std::ios_base::uppercase;
+        }
+        if (spec.width < 0) {
+            spec.flags |= std::ios_base::left;
+        }
 
-    void format::reset()
-    {
-        specifiers_.clear();
-        initialize();
-    }
+        instruction op;
+        op.code = opcode::emit_arg;
+        op.offset = specifiers_.size();
+        op.length = 0;
+        program_.push_back(op);
 
-    void format::reset(const std::string &value)
-    {
-        value_ = value;
-        reset();
+        specifiers_.push_back(std::move(spec));
     }
 
-    std::string format::str()
+    void format::add_literal(std::string::size_type start, std::string::size_type end)
     {
-        std::ostringstream buf;
-        print(buf);
-        return buf.str();
-    }
+        const auto offset = literals_.size();
 
-    void format::unescape(std::ostream &buf, std::string::size_type start, std::string::size_type end)
-    {
         for (auto i = start; i < end; ++i) {
+            CODA_COUNT_PARSE(1);
+
             char tag = value_[i];
 
             if (tag != s_open_tag && tag != s_close_tag) {
-                buf << tag;
+                literals_.push_back(tag);
                 continue;
             }
 
@@ -338,40 +878,1425 @@ namespace coda
                 i++;
             }
 
-            buf << tag;
+            literals_.push_back(tag);
         }
-    }
 
-    void format::print(std::ostream &buf)
-    {
-        if (specifiers_.empty()) {
-            unescape(buf, 0, value_.length());
+        if (literals_.size() == offset) {
             return;
         }
 
-        specifiers_.sort([&](const specifier &first, const specifier &second) { return first.prev < second.prev; });
+        instruction op;
+        op.code = opcode::copy_literal;
+        op.offset = offset;
+        op.length = literals_.size() - offset;
+        program_.push_back(op);
+    }
 
-        std::size_t last = 0;
-        for (auto spec = specifiers_.begin(); spec != currentSpecifier_; ++spec) {
-            if (spec->prev != 0) {
-                unescape(buf, last, spec->prev);
-            }
+    format::parse_result format::validate(std::string_view str) noexcept
+    {
+        std::size_t count = 0;
+        return validate(str, count);
+    }
 
-            buf << spec->replacement;
-            last = spec->next;
-        }
+    format::parse_result format::validate(std::string_view str, std::size_t &count) noexcept
+    {
+        // one bit per positional index, so duplicates are found without allocating
+        std::uint64_t seen[max_specifiers / 64] = {};
 
-        if (last < value_.length()) {
-            unescape(buf, last, value_.length());
-        }
+        count = 0;
+        std::size_t largest = 0;
+        std::size_t largest_offset = 0;
+        bool named = false;
+        bool positional = false;
+
+        const auto len = str.length();
+
+        for (std::size_t pos = 0; pos < len; pos++) {
+            CODA_COUNT_PARSE(1);
+
+            if (str[pos] != s_open_tag) {
+                continue;
+            }
+
+            if (pos + 1 >= len) break;
+
+            if (str[pos + 1] == s_open_tag) {
+                pos++;
+                continue;
+            }
+
+            const auto end = str.find(s_close_tag, pos + 1);
+            if (end == std::string_view::npos) {
+                return parse_result{parse_error::missing_close_tag, pos};
+            }
+
+            CODA_COUNT_PARSE(end - pos);
+
+            specifier_fields fields;
+            std::size_t offset = 0;
+            const auto error = parse_specifier(str.substr(pos + 1, end - pos - 1), fields, offset);
+            if (error != parse_error::none) {
+                return parse_result{error, pos + 1 + offset};
+            }
+
+            if (count == max_specifiers) {
+                return parse_result{parse_error::too_many_specifiers, pos};
+            }
+            ++count;
+
+            if (!fields.name.empty()) {
+                if (positional) {
+                    return parse_result{parse_error::mixed_specifiers, pos};
+                }
+                named = true;
+            } else {
+                if (named) {
+                    return parse_result{parse_error::mixed_specifiers, pos};
+                }
+                positional = true;
+
+                // an index past the limit can never be part of a contiguous set
+                if (fields.index >= max_specifiers) {
+                    return parse_result{parse_error::non_contiguous_indexes, pos};
+                }
+
+                auto &word = seen[fields.index / 64];
+                const auto bit = std::uint64_t(1) << (fields.index % 64);
+                if (word & bit) {
+                    return parse_result{parse_error::duplicate_index, pos};
+                }
+                word |= bit;
+
+                if (fields.index >= largest) {
+                    largest = fields.index;
+                    largest_offset = pos;
+                }
+            }
+
+            pos = end;
+        }
+
+        // distinct indexes are 0..n-1 exactly when the largest is below the count
+        if (positional && largest >= count) {
+            return parse_result{parse_error::non_contiguous_indexes, largest_offset};
+        }
+
+        return parse_result{parse_error::none, 0};
+    }
+
+    format::parse_result format::try_parse(const std::string &str, format &out) noexcept
+    {
+        std::size_t count = 0;
+        const auto result = validate(str, count);
+        if (!result) {
+            return result;
+        }
+
+        try {
+            // the target keeps its escaping and width unit, only the string changes
+            format parsed;
+            parsed.escape_ = out.escape_;
+            parsed.measure_ = out.measure_;
+            parsed.value_ = str;
+            parsed.build(count);
+            out = std::move(parsed);
+        } catch (const std::bad_alloc &) {
+            return parse_result{parse_error::out_of_memory, 0};
+        } catch (...) {
+            // validate accepted the string, so any other failure is the build's
+            return parse_result{parse_error::build_failed, 0};
+        }
+
+        return result;
+    }
+
+    const char *format::parse_result::message() const noexcept
+    {
+        switch (error) {
+            case parse_error::none:
+                return "no error";
+            case parse_error::missing_close_tag:
+                return "no specifier closing tag";
+            case parse_error::invalid_specifier:
+                return "invalid specifier format";
+            case parse_error::invalid_index:
+                return "invalid specifier index";
+            case parse_error::invalid_name:
+                return "invalid specifier name";
+            case parse_error::invalid_width:
+                return "invalid specifier width";
+            case parse_error::width_out_of_range:
+                return "specifier width out of range";
+            case parse_error::invalid_escape:
+                return "invalid specifier escaping";
+            case parse_error::mixed_specifiers:
+                return "mixed named and positional specifiers";
+            case parse_error::duplicate_index:
+                return "duplicate specifier index";
+            case parse_error::non_contiguous_indexes:
+                return "specifier indexes not contiguous";
+            case parse_error::too_many_specifiers:
+                return "too many specifiers";
+            case parse_error::out_of_memory:
+                return "out of memory";
+            case parse_error::build_failed:
+                return "could not build the format";
+        }
+        return "unknown error";
+    }
+
+    void format::initialize()
+    {
+        std::size_t count = 0;
+        const auto result = validate(value_, count);
+        if (!result) {
+            throw std::invalid_argument(std::string(result.message()) + " at offset " +
+                                        std::to_string(result.offset));
+        }
+
+        build(count);
+    }
+
+    void format::build(std::size_t count)
+    {
+        literals_.clear();
+        specifiers_.clear();
+        program_.clear();
+
+        // sized up front so the lists are allocated once
+        literals_.reserve(value_.size());
+        specifiers_.reserve(count);
+        program_.reserve(count * 2 + 1);
+        cursor_ = 0;
+        refreshed_ = false;
+
+        auto len = value_.length();
+        std::size_t literal = 0;
+
+        for (std::size_t pos = 0; pos < len; pos++) {
+            CODA_COUNT_PARSE(1);
+
+            if (value_[pos] != s_open_tag) {
+                continue;
+            }
+
+            if (pos + 1 >= len) break;
+
+            if (value_[pos + 1] == s_open_tag) {
+                pos++;
+                continue;
+            }
+
+            auto end = value_.find(s_close_tag, pos + 1);
+
+            CODA_COUNT_PARSE(end - pos);
+
+            add_literal(literal, pos);
+            add_specifier(pos + 1, end);
+
+            // scanning resumes after the specifier
+            literal = end + 1;
+            pos = end;
+        }
+
+        add_literal(literal, len);
+
+        order_arguments();
+        build_names();
+
+        cursor_ = 0;
+        unbound_ = arguments_;
+    }
+
+    void format::order_arguments()
+    {
+        const auto count = specifiers_.size();
+
+        // validation rejected mixing, so the first specifier decides
+        const bool named = count != 0 && specifiers_[0].name_length != 0;
+
+        if (named) {
+            // names are numbered by their first appearance
+            std::unordered_map<std::string_view, std::size_t> indexes;
+            const std::string_view source(value_);
+
+            for (auto &spec : specifiers_) {
+                CODA_COUNT_PARSE(1);
+
+                const auto result = indexes.emplace(source.substr(spec.name, spec.name_length), indexes.size());
+                spec.index = result.first->second;
+            }
+
+            arguments_ = indexes.size();
+        } else {
+            arguments_ = count;
+        }
+
+        if (!named) {
+            // validation made positional indexes a permutation of 0..n-1, so the
+            // specifiers are sorted in place by following each cycle
+            for (auto &op : program_) {
+                if (op.code == opcode::emit_arg) {
+                    op.offset = specifiers_[op.offset].index;
+                }
+            }
+
+            for (std::size_t slot = 0; slot < count; ++slot) {
+                while (specifiers_[slot].index != slot) {
+                    CODA_COUNT_PARSE(1);
+
+                    std::swap(specifiers_[slot], specifiers_[specifiers_[slot].index]);
+                }
+            }
+            return;
+        }
+
+        // the first specifier of each argument moves to its index, repeats of a name follow
+        SpecifierList ordered(count, specifiers_.get_allocator());
+        std::vector<std::size_t> position(count);
+        std::vector<std::size_t> last(arguments_, npos);
+        std::size_t next = arguments_;
+
+        for (std::size_t slot = 0; slot < count; ++slot) {
+            CODA_COUNT_PARSE(1);
+
+            auto &spec = specifiers_[slot];
+            std::size_t target = spec.index;
+
+            if (last[spec.index] != npos) {
+                target = next++;
+                ordered[last[spec.index]].repeat = target;
+            }
+
+            last[spec.index] = target;
+            position[slot] = target;
+            ordered[target] = std::move(spec);
+        }
+
+        // emit_arg operands were text order slots
+        for (auto &op : program_) {
+            if (op.code == opcode::emit_arg) {
+                op.offset = position[op.offset];
+            }
+        }
+
+        specifiers_.swap(ordered);
+    }
+
+    void format::build_names()
+    {
+        names_.clear();
+        displacements_.clear();
+        seed_ = 0;
+
+        if (arguments_ == 0 || specifiers_[0].name_length == 0) {
+            return;
+        }
+
+        // hash and displace: names are grouped into buckets by one hash, and
+        // each bucket, largest first, gets a displacement placing all of its
+        // names in free slots, so a lookup is two hashes and one comparison
+        const auto size = power_of_two(arguments_ * 2);
+        const auto buckets = power_of_two(arguments_ / 4 + 1);
+
+        std::vector<std::uint64_t> hashes(arguments_);
+        std::vector<std::vector<std::size_t>> members(buckets);
+        std::vector<std::size_t> order(buckets);
+        std::vector<std::size_t> slots;
+
+        for (std::uint64_t seed = 0; seed < CODA_FORMAT_NAME_SEEDS; ++seed) {
+            for (auto &bucket : members) {
+                bucket.clear();
+            }
+
+            for (std::size_t index = 0; index < arguments_; ++index) {
+                const auto &spec = specifiers_[index];
+                hashes[index] = hash_name(value_.data() + spec.name, spec.name_length, seed);
+                members[hashes[index] & (buckets - 1)].push_back(index);
+            }
+
+            for (std::size_t i = 0; i < buckets; ++i) {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(),
+                      [&](std::size_t first, std::size_t second) { return members[first].size() > members[second].size(); });
+
+            names_.assign(size, 0);
+            displacements_.assign(buckets, 0);
+
+            bool placed = true;
+            for (const auto bucket : order) {
+                const auto &names = members[bucket];
+                if (names.empty()) {
+                    break;
+                }
+
+                placed = false;
+                for (std::uint32_t displacement = 0; displacement < 4096 && !placed; ++displacement) {
+                    CODA_COUNT_PARSE(names.size());
+
+                    slots.clear();
+                    placed = true;
+
+                    for (const auto index : names) {
+                        const auto slot = displace_hash(hashes[index], displacement) & (size - 1);
+                        if (names_[slot] != 0 || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                            placed = false;
+                            break;
+                        }
+                        slots.push_back(slot);
+                    }
+
+                    if (placed) {
+                        for (std::size_t i = 0; i < names.size(); ++i) {
+                            names_[slots[i]] = names[i] + 1;
+                        }
+                        displacements_[bucket] = displacement;
+                    }
+                }
+
+                if (!placed) {
+                    break;
+                }
+            }
+
+            if (placed) {
+                seed_ = seed;
+                return;
+            }
+        }
+
+        // no seed placed every name, so names are sorted for a binary search instead
+        names_.resize(arguments_);
+        displacements_.clear();
+        seed_ = 0;
+
+        for (std::size_t index = 0; index < arguments_; ++index) {
+            names_[index] = index + 1;
+        }
+
+        std::sort(names_.begin(), names_.end(),
+                  [this](std::size_t first, std::size_t second) { return name_of(first - 1) < name_of(second - 1); });
+    }
+
+    std::string_view format::name_of(std::size_t index) const
+    {
+        const auto &spec = specifiers_[index];
+        return std::string_view(value_).substr(spec.name, spec.name_length);
+    }
+
+    std::size_t format::find_argument(std::string_view name) const
+    {
+        if (names_.empty()) {
+            return npos;
+        }
+
+        if (displacements_.empty()) {
+            const auto found =
+                std::lower_bound(names_.begin(), names_.end(), name,
+                                 [this](std::size_t entry, std::string_view key) { return name_of(entry - 1) < key; });
+
+            if (found == names_.end() || name_of(*found - 1) != name) {
+                return npos;
+            }
+
+            return *found - 1;
+        }
+
+        const auto hash = hash_name(name.data(), name.size(), seed_);
+        const auto displacement = displacements_[hash & (displacements_.size() - 1)];
+        const auto entry = names_[displace_hash(hash, displacement) & (names_.size() - 1)];
+
+        if (entry == 0) {
+            return npos;
+        }
+
+        const auto &spec = specifiers_[entry - 1];
+        if (value_.compare(spec.name, spec.name_length, name.data(), name.size()) != 0) {
+            return npos;
+        }
+
+        return entry - 1;
+    }
+
+    void format::begin_manip(std::ostream &out, const specifier &arg) const
+    {
+        if (arg.convert == conversion::invalid) {
+            throw std::invalid_argument("invalid precision format for argument");
+        }
+        if (arg.convert == conversion::time) {
+            throw std::invalid_argument("invalid time argument");
+        }
+
+        out.flags(arg.flags);
+        out.fill(arg.fill);
+        out.precision(arg.precision);
+
+        // streams pad by bytes, other widths are padded by end_manip
+        out.width(measure_ == width_unit::bytes ? arg.padding : 0);
+    }
+
+    void format::end_manip(std::ostream &out, specifier &arg) const
+    {
+        if (measure_ != width_unit::bytes) {
+            pad(arg);
+        }
+
+        if (arg.newline) {
+            out << std::endl;
+        }
+
+        CODA_COUNT_RENDER(arg.replacement.size());
+    }
+
+    bool format::localized(const specifier &arg)
+    {
+        // dumps and times are never localized, and keep their type errors
+        if (arg.convert == conversion::dump || arg.convert == conversion::time) {
+            return false;
+        }
+
+        return std::locale() != std::locale::classic();
+    }
+
+    void format::pad(specifier &arg) const
+    {
+        // the padding, not the width, so a hex value keeps its two digits as emit does
+        const std::size_t width = arg.padding;
+
+        CODA_COUNT_RENDER(width + arg.replacement.size());
+
+        if (width == 0) {
+            return;
+        }
+
+        const auto length = display_width(arg.replacement.data(), arg.replacement.size());
+        if (width <= length) {
+            return;
+        }
+
+        if (arg.width < 0) {
+            arg.replacement.append(width - length, arg.fill);
+        } else {
+            arg.replacement.insert(0, width - length, arg.fill);
+        }
+    }
+
+    std::size_t format::display_width(const char *value, std::size_t length) const
+    {
+        return width_in(measure_, value, length);
+    }
+
+    void format::emit(specifier &arg, const char *value, std::size_t length) const
+    {
+        auto &out = arg.replacement;
+        out.clear();
+
+        CODA_COUNT_RENDER(arg.padding + length);
+
+        const auto width = arg.padding == 0 ? length : display_width(value, length);
+
+        if (width >= arg.padding) {
+            out.append(value, length);
+        } else if (arg.width < 0) {
+            out.append(value, length);
+            out.append(arg.padding - width, arg.fill);
+        } else {
+            out.append(arg.padding - width, arg.fill);
+            out.append(value, length);
+        }
+
+        if (arg.newline) {
+            out.push_back('\n');
+        }
+    }
+
+    void format::convert_integer(specifier &arg, std::uint64_t bits, std::uint64_t magnitude, bool negative) const
+    {
+        char buf[24];
+        char *end = buf + sizeof(buf);
+        char *pos = end;
+
+        switch (arg.convert) {
+            case conversion::invalid:
+                throw std::invalid_argument("invalid precision format for argument");
+            case conversion::dump:
+                throw std::invalid_argument("invalid hex dump argument");
+            case conversion::time:
+                throw std::invalid_argument("invalid time argument");
+            case conversion::hex: {
+                const char *digits = arg.uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+                do {
+                    *--pos = digits[bits & 0xF];
+                    bits >>= 4;
+                } while (bits != 0);
+                break;
+            }
+            case conversion::oct:
+                do {
+                    *--pos = static_cast<char>('0' + (bits & 0x7));
+                    bits >>= 3;
+                } while (bits != 0);
+                break;
+            default:
+                pos = write_decimal(end, magnitude);
+                if (negative) {
+                    *--pos = '-';
+                }
+                break;
+        }
+
+        emit(arg, pos, static_cast<std::size_t>(end - pos));
+    }
+
+    void format::convert_floating(specifier &arg, double value) const
+    {
+        // a fixed 1e308 with the largest precision needs 309 + 1 + 127 characters
+        char buf[512];
+
+        const auto length = write_floating(arg, value, buf, sizeof(buf));
+
+        emit(arg, buf, length);
+    }
+
+    std::size_t format::write_floating(const specifier &arg, double value, char *buf, std::size_t size) const
+    {
+        std::size_t length = 0;
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        std::chars_format style = std::chars_format::general;
+#else
+        const char *style = arg.uppercase ? "%.*G" : "%.*g";
+#endif
+
+        switch (arg.convert) {
+            case conversion::invalid:
+                throw std::invalid_argument("invalid precision format for argument");
+            case conversion::dump:
+                throw std::invalid_argument("invalid hex dump argument");
+            case conversion::time:
+                throw std::invalid_argument("invalid time argument");
+            case conversion::fixed:
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+                style = std::chars_format::fixed;
+#else
+                style = arg.uppercase ? "%.*F" : "%.*f";
+#endif
+                break;
+            case conversion::scientific:
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+                style = std::chars_format::scientific;
+#else
+                style = arg.uppercase ? "%.*E" : "%.*e";
+#endif
+                break;
+            default:
+                break;
+        }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        // as printf in the "C" locale, which is what the stream would produce
+        const auto result = std::to_chars(buf, buf + size, value, style, arg.precision);
+        length = static_cast<std::size_t>(result.ptr - buf);
+
+        if (arg.uppercase) {
+            std::transform(buf, buf + length, buf, [](char ch) {
+                return ch >= 'a' && ch <= 'z' ? static_cast<char>(ch - 'a' + 'A') : ch;
+            });
+        }
+#else
+        length = static_cast<std::size_t>(std::snprintf(buf, size, style, arg.precision, value));
+#endif
+
+        return length;
+    }
+
+    char *format::write_padded(char *pos, const specifier &arg, const char *value, std::size_t length)
+    {
+        if (length < arg.padding && arg.width >= 0) {
+            std::memset(pos, arg.fill, arg.padding - length);
+            pos += arg.padding - length;
+        }
+
+        std::memcpy(pos, value, length);
+        pos += length;
+
+        if (length < arg.padding && arg.width < 0) {
+            std::memset(pos, arg.fill, arg.padding - length);
+            pos += arg.padding - length;
+        }
+
+        return pos;
+    }
+
+    void format::append_integers(specifier &arg, const std::uint64_t *values, std::size_t count, std::size_t size,
+                                 bool is_signed, std::string_view separator, bool first) const
+    {
+        if (arg.convert == conversion::invalid) {
+            throw std::invalid_argument("invalid precision format for argument");
+        }
+        if (arg.convert == conversion::dump) {
+            throw std::invalid_argument("invalid hex dump argument");
+        }
+        if (arg.convert == conversion::time) {
+            throw std::invalid_argument("invalid time argument");
+        }
+
+        auto &out = arg.replacement;
+
+        // the longest element is a sign and 22 octal digits, or its padding
+        const std::size_t longest = std::max<std::size_t>(arg.padding, 23) + separator.size();
+        const auto start = out.size();
+
+        out.resize(start + count * longest);
+
+        char *pos = &out[start];
+
+        const std::uint64_t sign = std::uint64_t(1) << (size * 8 - 1);
+
+        // hex digits are expanded a block at a time
+        static const std::size_t block_size = 64;
+        char hex[block_size * 16];
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (arg.convert == conversion::hex && i % block_size == 0) {
+                kernels::expand_hex(values + i, std::min(block_size, count - i), arg.uppercase, hex);
+            }
+
+            if (i != 0 || !first) {
+                std::memcpy(pos, separator.data(), separator.size());
+                pos += separator.size();
+            }
+
+            auto bits = values[i];
+
+            char buf[24];
+            char *end = buf + sizeof(buf);
+            const char *digits = end;
+
+            if (arg.convert == conversion::hex) {
+                // the kernel wrote 16 digits, the leading zeros are dropped
+                const auto length = kernels::hex_length(bits);
+                digits = hex + (i % block_size) * 16 + 16 - length;
+                end = hex + (i % block_size) * 16 + 16;
+            } else if (arg.convert == conversion::oct) {
+                char *oct = end;
+                do {
+                    *--oct = static_cast<char>('0' + (bits & 0x7));
+                    bits >>= 3;
+                } while (bits != 0);
+                digits = oct;
+            } else {
+                const bool negative = is_signed && (bits & sign) != 0;
+                char *decimal = write_decimal(end, negative ? (0 - bits) & ((sign << 1) - 1) : bits);
+                if (negative) {
+                    *--decimal = '-';
+                }
+                digits = decimal;
+            }
+
+            pos = write_padded(pos, arg, digits, static_cast<std::size_t>(end - digits));
+        }
+
+        CODA_COUNT_RENDER(pos - &out[start]);
+
+        out.resize(static_cast<std::size_t>(pos - out.data()));
+    }
+
+    void format::append_floating(specifier &arg, const double *values, std::size_t count,
+                                 std::string_view separator, bool first) const
+    {
+        if (arg.convert == conversion::invalid) {
+            throw std::invalid_argument("invalid precision format for argument");
+        }
+        if (arg.convert == conversion::dump) {
+            throw std::invalid_argument("invalid hex dump argument");
+        }
+        if (arg.convert == conversion::time) {
+            throw std::invalid_argument("invalid time argument");
+        }
+
+        auto &out = arg.replacement;
+
+        char buf[512];
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i != 0 || !first) {
+                out.append(separator.data(), separator.size());
+            }
+
+            const auto length = write_floating(arg, values[i], buf, sizeof(buf));
+            const auto start = out.size();
+
+            out.resize(start + std::max<std::size_t>(arg.padding, length));
+            write_padded(&out[start], arg, buf, length);
+
+            CODA_COUNT_RENDER(arg.padding + length);
+        }
+    }
+
+    void format::convert_string(specifier &arg, const char *value, std::size_t length) const
+    {
+        if (arg.convert == conversion::invalid) {
+            throw std::invalid_argument("invalid precision format for argument");
+        }
+        if (arg.convert == conversion::time) {
+            throw std::invalid_argument("invalid time argument");
+        }
+
+        if (arg.convert == conversion::dump) {
+            convert_bytes(arg, reinterpret_cast<const unsigned char *>(value), length);
+            return;
+        }
+
+        emit(arg, value, length);
+    }
+
+    void format::convert_bytes(specifier &arg, const unsigned char *value, std::size_t length) const
+    {
+        if (arg.convert == conversion::invalid) {
+            throw std::invalid_argument("invalid precision format for argument");
+        }
+        if (arg.convert == conversion::time) {
+            throw std::invalid_argument("invalid time argument");
+        }
+
+        auto &out = arg.replacement;
+        out.clear();
+
+        const std::size_t group = arg.convert == conversion::dump ? arg.group : 0;
+        const std::size_t separators = group == 0 || length == 0 ? 0 : (length - 1) / group;
+
+        out.resize(length * 2 + separators);
+
+        CODA_COUNT_RENDER(out.size());
+
+        if (separators == 0) {
+            kernels::hex_encode(value, length, arg.uppercase, &out[0]);
+        } else {
+            // encoded a block at a time, then copied out a group at a time
+            char block[4096];
+            const std::size_t block_length = sizeof(block) / 2 / group * group;
+
+            char *pos = &out[0];
+            for (std::size_t offset = 0; offset < length; offset += block_length) {
+                const auto count = std::min(block_length, length - offset);
+                kernels::hex_encode(value + offset, count, arg.uppercase, block);
+
+                for (std::size_t i = 0; i < count; i += group) {
+                    if (offset + i != 0) {
+                        *pos++ = arg.separator;
+                    }
+                    const auto bytes = std::min(group, count - i);
+                    std::memcpy(pos, block + i * 2, bytes * 2);
+                    pos += bytes * 2;
+                }
+            }
+        }
+
+        pad(arg);
+    }
+
+    void format::convert_time(specifier &arg, std::int64_t seconds, std::uint32_t nanoseconds) const
+    {
+        if (arg.convert == conversion::invalid) {
+            throw std::invalid_argument("invalid time format for argument");
+        }
+
+        // a time without a t specifier renders as whole seconds in UTC
+        const bool time = arg.convert == conversion::time;
+        if (!time && arg.convert != conversion::general) {
+            throw std::invalid_argument("invalid time argument");
+        }
+
+        const int digits = time ? arg.precision : 0;
+        const int zone = time && arg.zone != utc_zone ? arg.zone : 0;
+
+        // the local day and second of day, floored so times before the epoch work
+        std::int64_t days = seconds / 86400;
+        std::int64_t second = seconds % 86400;
+        if (second < 0) {
+            second += 86400;
+            --days;
+        }
+
+        second += zone * 60;
+        if (second < 0) {
+            second += 86400;
+            --days;
+        } else if (second >= 86400) {
+            second -= 86400;
+            ++days;
+        }
+
+        const auto &prefix = render_time_prefix(days, second);
+
+        char buf[64];
+        std::memcpy(buf, prefix.prefix, prefix.length);
+        char *pos = buf + prefix.length;
+
+        if (digits > 0) {
+            static const std::uint32_t scale[] = {1000000000, 100000000, 10000000, 1000000, 100000,
+                                                  10000,      1000,      100,      10,      1};
+
+            *pos++ = '.';
+
+            // the leading digits of the fraction, written from the end
+            auto fraction = nanoseconds / scale[digits];
+            char *end = pos + digits;
+            char *digit = end;
+            for (int i = digits; i >= 2; i -= 2) {
+                digit -= 2;
+                write_pair(digit, fraction % 100);
+                fraction /= 100;
+            }
+            if (digit != pos) {
+                *pos = static_cast<char>('0' + fraction);
+            }
+            pos = end;
+        }
+
+        if (!time || arg.zone == utc_zone) {
+            *pos++ = 'Z';
+        } else {
+            const auto minutes = static_cast<unsigned>(std::abs(zone));
+            *pos++ = zone < 0 ? '-' : '+';
+            pos = write_pair(pos, minutes / 60);
+            *pos++ = ':';
+            pos = write_pair(pos, minutes % 60);
+        }
+
+        emit(arg, buf, static_cast<std::size_t>(pos - buf));
+    }
+
+    void format::escape_replacement(specifier &arg) const
+    {
+        escape_value(arg);
+
+        // padded and ended once escaped, so neither is escaped and the width is the escaped width
+        pad(arg);
+
+        if (arg.newline) {
+            arg.replacement.push_back('\n');
+        }
+    }
+
+    void format::escape_value(specifier &arg) const
+    {
+        const auto mode = arg.inherit ? escape_ : arg.escape;
+        const auto set = mode == escaping::json   ? kernels::escape_set::json
+                         : mode == escaping::html ? kernels::escape_set::html
+                                                  : kernels::escape_set::csv;
+
+        const std::pmr::string &value = arg.replacement;
+
+        auto pos = kernels::find_escape(value.data(), value.size(), set);
+
+        CODA_COUNT_RENDER(pos);
+
+        // most values need no escaping and are left as they are
+        if (pos == value.size()) {
+            return;
+        }
+
+        std::pmr::string escaped(value.get_allocator());
+        escaped.reserve(value.size() + value.size() / 8 + 8);
+
+        if (mode == escaping::csv) {
+            // the field is quoted, and quotes inside it are doubled
+            escaped.push_back('"');
+
+            std::size_t start = 0;
+            for (auto quote = value.find('"'); quote != std::string::npos; quote = value.find('"', quote + 1)) {
+                escaped.append(value, start, quote + 1 - start);
+                escaped.push_back('"');
+                start = quote + 1;
+            }
+
+            escaped.append(value, start, std::string::npos);
+            escaped.push_back('"');
+
+            CODA_COUNT_RENDER(value.size());
+
+            arg.replacement.swap(escaped);
+            return;
+        }
+
+        std::size_t start = 0;
+        while (pos < value.size()) {
+            escaped.append(value, start, pos - start);
+
+            const auto ch = static_cast<unsigned char>(value[pos]);
+
+            if (mode == escaping::json) {
+                switch (ch) {
+                    case '"':
+                        escaped.append("\\\"", 2);
+                        break;
+                    case '\\':
+                        escaped.append("\\\\", 2);
+                        break;
+                    case '\n':
+                        escaped.append("\\n", 2);
+                        break;
+                    case '\r':
+                        escaped.append("\\r", 2);
+                        break;
+                    case '\t':
+                        escaped.append("\\t", 2);
+                        break;
+                    case '\b':
+                        escaped.append("\\b", 2);
+                        break;
+                    case '\f':
+                        escaped.append("\\f", 2);
+                        break;
+                    default: {
+                        const char digits[] = "0123456789abcdef";
+                        const char unicode[] = {'\\', 'u', '0', '0', digits[ch >> 4], digits[ch & 0xF]};
+                        escaped.append(unicode, sizeof(unicode));
+                        break;
+                    }
+                }
+            } else {
+                switch (ch) {
+                    case '<':
+                        escaped.append("&lt;", 4);
+                        break;
+                    case '>':
+                        escaped.append("&gt;", 4);
+                        break;
+                    case '&':
+                        escaped.append("&amp;", 5);
+                        break;
+                    case '"':
+                        escaped.append("&quot;", 6);
+                        break;
+                    default:
+                        escaped.append("&#39;", 5);
+                        break;
+                }
+            }
+
+            start = pos + 1;
+            pos = start + kernels::find_escape(value.data() + start, value.size() - start, set);
+
+            CODA_COUNT_RENDER(pos - start + 1);
+        }
+
+        escaped.append(value, start, std::string::npos);
+
+        arg.replacement.swap(escaped);
+    }
+
+    // the fills of the padded format arguments of one render, on the stack unless deeply nested
+    struct format::nested_fills {
+        std::size_t local[16];
+        std::vector<std::size_t> spilled;  // every fill, once there are more than fit locally
+        std::size_t count = 0;
+
+        std::size_t *data()
+        {
+            return spilled.empty() ? local : spilled.data();
+        }
+
+        std::size_t add()
+        {
+            if (count == sizeof(local) / sizeof(local[0])) {
+                spilled.assign(local, local + count);
+            }
+            if (spilled.empty()) {
+                local[count] = 0;
+            } else {
+                spilled.push_back(0);
+            }
+            return count++;
+        }
+    };
+
+    template <typename Sink>
+    void format::render(Sink &out) const
+    {
+        const std::size_t *fills = nullptr;
+
+        render_program(out, fills);
+    }
+
+    template <typename Sink>
+    void format::render_program(Sink &out, const std::size_t *&fills) const
+    {
+        for (const auto &op : program_) {
+            CODA_COUNT_RENDER(1 + op.length);
+
+            switch (op.code) {
+                case opcode::copy_literal:
+                    out.append(literals_.data() + op.offset, op.length);
+                    break;
+                case opcode::emit_arg: {
+                    const auto &spec = specifiers_[op.offset];
+                    if (spec.nested != nullptr) {
+                        render_argument(out, spec, *spec.nested, fills);
+                    } else if (spec.bound) {
+                        CODA_COUNT_RENDER(spec.replacement.size());
+                        out.append(spec.replacement.data(), spec.replacement.size());
+                    } else {
+                        // unbound specifiers render as written
+                        out.append(value_.data() + spec.start, spec.length);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    template <typename Sink>
+    void format::render_nested(Sink &out, const specifier &arg, const format &value) const
+    {
+        const std::size_t *fills = nullptr;
+
+        render_argument(out, arg, value, fills);
+    }
+
+    template <typename Sink>
+    void format::render_argument(Sink &out, const specifier &arg, const format &value,
+                                 const std::size_t *&fills) const
+    {
+        if (arg.padding != 0 && fills == nullptr) {
+            // the first padded argument reached measures its whole subtree once, keeping
+            // the fills of the padded arguments inside it for when they render
+            nested_fills storage;
+            storage.add();
+
+            const auto width = value.measure_output(measure_, &storage);
+            storage.data()[0] = width < arg.padding ? arg.padding - width : 0;
+
+            const std::size_t *measured = storage.data();
+            render_argument(out, arg, value, measured);
+            return;
+        }
+
+        const std::size_t fill = arg.padding != 0 ? *fills++ : 0;
+
+        CODA_COUNT_RENDER(fill);
+
+        if (arg.width >= 0) {
+            append_fill(out, arg.fill, fill);
+        }
+
+        // the nested program writes straight to this sink
+        value.render_program(out, fills);
+
+        if (arg.width < 0) {
+            append_fill(out, arg.fill, fill);
+        }
+
+        if (arg.newline) {
+            out.append("\n", 1);
+        }
+    }
+
+    std::size_t format::measure_output(width_unit unit, nested_fills *fills) const
+    {
+        std::size_t total = 0;
+
+        for (const auto &op : program_) {
+            CODA_COUNT_RENDER(1 + op.length);
+
+            if (op.code == opcode::copy_literal) {
+                total += width_in(unit, literals_.data() + op.offset, op.length);
+                continue;
+            }
+
+            const auto &spec = specifiers_[op.offset];
+
+            if (spec.nested == nullptr) {
+                if (spec.bound) {
+                    total += width_in(unit, spec.replacement.data(), spec.replacement.size());
+                } else {
+                    total += width_in(unit, value_.data() + spec.start, spec.length);
+                }
+                continue;
+            }
+
+            const std::size_t newline = spec.newline ? 1 : 0;
+
+            if (spec.padding == 0) {
+                total += spec.nested->measure_output(unit, fills) + newline;
+                continue;
+            }
+
+            // the slot is taken before the arguments below, the order render reaches them
+            const auto slot = fills != nullptr ? fills->add() : 0;
+
+            // the padding is measured in this format's unit and fills with one byte characters
+            const auto own = spec.nested->measure_output(measure_, fills);
+            const auto width = unit == measure_ ? own : spec.nested->measure_output(unit, nullptr);
+            const std::size_t fill = own < spec.padding ? spec.padding - own : 0;
+
+            if (fills != nullptr) {
+                fills->data()[slot] = fill;
+            }
+
+            total += width + fill + newline;
+        }
+
+        return total;
+    }
+
+    void format::bind_format(specifier &arg, const format &value) const
+    {
+        if (arg.convert == conversion::invalid) {
+            throw std::invalid_argument("invalid precision format for argument");
+        }
+        if (arg.convert == conversion::time) {
+            throw std::invalid_argument("invalid time argument");
+        }
+
+        // escaping needs the text, and a cycle would never finish rendering. only a
+        // format bound by reference can be shown by the argument, so the walk is rare
+        if ((arg.inherit ? escape_ : arg.escape) != escaping::none || &value == this ||
+            (referenced_ && value.refers_to(this))) {
+            // rendered aside, since the argument may show this replacement
+            std::pmr::string copy(arg.replacement.get_allocator());
+
+            format_sink sink(copy);
+            render_nested(sink, arg, value);
+
+            arg.replacement.swap(copy);
+            return;
+        }
+
+        arg.replacement.clear();
+        arg.nested = &value;
+        value.referenced_ = true;
+    }
+
+    void format::expand(specifier &arg, const format &value) const
+    {
+        arg.replacement.clear();
+
+        format_sink sink(arg.replacement);
+        render_nested(sink, arg, value);
+    }
+
+    void format::flatten(specifier &arg) const
+    {
+        const auto &value = *arg.nested;
+
+        arg.nested = nullptr;
+        expand(arg, value);
+    }
+
+    void format::detach(std::size_t index)
+    {
+        for (auto slot = index; slot != npos; slot = specifiers_[slot].repeat) {
+            auto &spec = specifiers_[slot];
+
+            if (spec.nested != nullptr) {
+                flatten(spec);
+            }
+        }
+    }
+
+    bool format::refers_to(const format *target) const
+    {
+        if (this == target) {
+            return true;
+        }
+
+        for (const auto &spec : specifiers_) {
+            if (spec.nested != nullptr && spec.nested->refers_to(target)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void format::detach_from(const format *target)
+    {
+        for (auto &spec : specifiers_) {
+            if (spec.nested != nullptr && spec.nested->refers_to(target)) {
+                flatten(spec);
+                spec.dirty = true;
+            }
+        }
+    }
+
+    void format::reset()
+    {
+        for (auto &spec : specifiers_) {
+            spec.replacement.clear();
+            spec.nested = nullptr;
+            spec.dirty = spec.bound;
+            spec.bound = false;
+        }
+        cursor_ = 0;
+        unbound_ = arguments_;
+    }
+
+    void format::reset(const std::string &value)
+    {
+        value_ = value;
+        initialize();
+    }
+
+    format &format::escape(escaping mode)
+    {
+        escape_ = mode;
+        return *this;
+    }
+
+    format &format::measure(width_unit unit)
+    {
+        measure_ = unit;
+        return *this;
+    }
+
+    std::string format::str() const
+    {
+        std::string value;
+        append_to(value);
+        return value;
+    }
+
+    void format::append_to(std::string &out) const
+    {
+        std::size_t length = literals_.size();
+        for (const auto &spec : specifiers_) {
+            length += spec.replacement.size();
+        }
+        out.reserve(out.size() + length);
+
+        string_sink sink{out};
+        render(sink);
+    }
+
+    std::size_t format::format_to(char *buffer, std::size_t size) const
+    {
+        buffer_sink sink{buffer, size, 0};
+        render(sink);
+        return sink.length;
+    }
+
+    std::string_view format::refresh(std::vector<range> *changed)
+    {
+        if (changed != nullptr) {
+            changed->clear();
+        }
+
+        const auto text = [this](const specifier &spec) {
+            if (spec.bound) {
+                return std::string_view(spec.replacement);
+            }
+            // unbound specifiers render as written
+            return std::string_view(value_).substr(spec.start, spec.length);
+        };
+
+        if (!refreshed_) {
+            rendered_.clear();
+            segments_.resize(specifiers_.size());
+
+            for (const auto &op : program_) {
+                CODA_COUNT_RENDER(1 + op.length);
+
+                if (op.code == opcode::copy_literal) {
+                    rendered_.append(literals_, op.offset, op.length);
+                    continue;
+                }
+
+                auto &spec = specifiers_[op.offset];
+
+                if (spec.nested != nullptr) {
+                    expand(spec, *spec.nested);
+                }
+
+                const auto value = text(spec);
+
+                CODA_COUNT_RENDER(value.size());
+
+                segments_[op.offset] = range{rendered_.size(), value.size()};
+                rendered_.append(value.data(), value.size());
+                spec.dirty = false;
+            }
+
+            if (changed != nullptr) {
+                changed->push_back(range{0, rendered_.size()});
+            }
+
+            refreshed_ = true;
+            return rendered_;
+        }
+
+        // literals are not copied again, only the offsets of later segments move
+        std::size_t shift = 0;
+        std::size_t tail = npos;
+
+        for (const auto &op : program_) {
+            if (op.code != opcode::emit_arg) {
+                continue;
+            }
+
+            CODA_COUNT_RENDER(1);
+
+            auto &segment = segments_[op.offset];
+            auto &spec = specifiers_[op.offset];
+
+            segment.offset += shift;
+
+            // a format argument can change without this format knowing
+            if (!spec.dirty && spec.nested == nullptr) {
+                continue;
+            }
+
+            spec.dirty = false;
+
+            if (spec.nested != nullptr) {
+                expand(spec, *spec.nested);
+            }
+
+            const auto value = text(spec);
+
+            CODA_COUNT_RENDER(value.size());
+
+            if (value.size() == segment.length && rendered_.compare(segment.offset, segment.length, value) == 0) {
+                continue;
+            }
+
+            rendered_.replace(segment.offset, segment.length, value.data(), value.size());
+
+            if (changed != nullptr && tail == npos) {
+                if (value.size() == segment.length) {
+                    changed->push_back(range{segment.offset, value.size()});
+                } else {
+                    tail = segment.offset;
+                }
+            }
+
+            // unsigned wrap around gives the same offsets for a shorter value
+            shift += value.size() - segment.length;
+            segment.length = value.size();
+        }
+
+        if (tail != npos) {
+            changed->push_back(range{tail, rendered_.size() - tail});
+        }
+
+        return rendered_;
+    }
+
+    void format::print(std::ostream &buf) const
+    {
+        stream_sink sink{buf};
+        render(sink);
     }
 
-    format::operator std::string()
+    format::operator std::string() const
     {
         return str();
     }
 
-    std::ostream &operator<<(std::ostream &out, format &f)
+    std::ostream &operator<<(std::ostream &out, const format &f)
     {
         f.print(out);
         return out;
@@ -0,0 +1,433 @@
+/*!
+ * implementation of the conversion kernels
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include "kernels.h"
+
+#include <string_view>
+
+#if defined(__SSE2__) && defined(__x86_64__)
+#define CODA_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+// SSSE3 and AVX2 versions are compiled with target attributes and chosen
+// at run time, so the library still runs on cpus without them
+#if defined(CODA_KERNELS_SSE2) && defined(__GNUC__)
+#define CODA_KERNELS_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace coda
+{
+    namespace kernels
+    {
+        namespace
+        {
+            struct codepoint_range {
+                char32_t first;
+                char32_t last;
+            };
+
+            // combining marks and zero width characters
+            const codepoint_range zero_width[] = {
+                {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A}, {0x064B, 0x065F},
+                {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF},
+                {0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064}, {0x20D0, 0x20FF}, {0xFE00, 0xFE0F},
+                {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0x1F3FB, 0x1F3FF}, {0xE0100, 0xE01EF}};
+
+            // east asian wide and fullwidth characters, including emoji
+            const codepoint_range wide[] = {
+                {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},   {0x23E9, 0x23EC},   {0x23F0, 0x23F0},
+                {0x23F3, 0x23F3},   {0x25FD, 0x25FE},   {0x2614, 0x2615},   {0x2648, 0x2653},   {0x267F, 0x267F},
+                {0x2693, 0x2693},   {0x26A1, 0x26A1},   {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},
+                {0x26CE, 0x26CE},   {0x26D4, 0x26D4},   {0x26EA, 0x26EA},   {0x26F2, 0x26F3},   {0x26F5, 0x26F5},
+                {0x26FA, 0x26FA},   {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},   {0x2728, 0x2728},
+                {0x274C, 0x274C},   {0x274E, 0x274E},   {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+                {0x27B0, 0x27B0},   {0x27BF, 0x27BF},   {0x2B1B, 0x2B1C},   {0x2B50, 0x2B50},   {0x2B55, 0x2B55},
+                {0x2E80, 0x303E},   {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},
+                {0xA960, 0xA97F},   {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},   {0xFE10, 0xFE19},   {0xFE30, 0xFE6F},
+                {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE4}, {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF},
+                {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251},
+                {0x1F300, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C}, {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA},
+                {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F3FA}, {0x1F400, 0x1F43E},
+                {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567},
+                {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F}, {0x1F680, 0x1F6C5},
+                {0x1F6CC, 0x1F6CC}, {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC},
+                {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAFF},
+                {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD}};
+
+            template <std::size_t N>
+            bool in_ranges(char32_t codepoint, const codepoint_range (&ranges)[N])
+            {
+                // the ranges are sorted, so a binary search finds the last one starting at or before it
+                const codepoint_range *first = ranges;
+                std::size_t count = N;
+                while (count > 0) {
+                    const auto half = count / 2;
+                    if (first[half].first <= codepoint) {
+                        first += half + 1;
+                        count -= half + 1;
+                    } else {
+                        count = half;
+                    }
+                }
+                return first != ranges && codepoint <= first[-1].last;
+            }
+
+            std::size_t column_width(char32_t codepoint)
+            {
+                if (codepoint < 0x300) {
+                    return 1;
+                }
+                if (in_ranges(codepoint, zero_width)) {
+                    return 0;
+                }
+                return in_ranges(codepoint, wide) ? 2 : 1;
+            }
+
+            [[maybe_unused]] void expand_hex_scalar(const std::uint64_t *values, std::size_t count, bool uppercase, char *out)
+            {
+                const char *digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+
+                for (std::size_t i = 0; i < count; ++i) {
+                    auto value = values[i];
+                    for (int pos = 15; pos >= 0; --pos) {
+                        out[pos] = digits[value & 0xF];
+                        value >>= 4;
+                    }
+                    out += 16;
+                }
+            }
+
+            const char hex_lower[] = "0123456789abcdef";
+            const char hex_upper[] = "0123456789ABCDEF";
+
+            void hex_encode_scalar(const unsigned char *data, std::size_t length, bool uppercase, char *out)
+            {
+                const char *digits = uppercase ? hex_upper : hex_lower;
+
+                for (std::size_t i = 0; i < length; ++i) {
+                    out[i * 2] = digits[data[i] >> 4];
+                    out[i * 2 + 1] = digits[data[i] & 0xF];
+                }
+            }
+
+#ifdef CODA_KERNELS_DISPATCH
+            // each byte is split into its nibbles, which index a digit table through a byte shuffle
+            __attribute__((target("ssse3"))) void hex_encode_ssse3(const unsigned char *data, std::size_t length,
+                                                                   bool uppercase, char *out)
+            {
+                const __m128i digits =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(uppercase ? hex_upper : hex_lower));
+                const __m128i mask = _mm_set1_epi8(0x0F);
+
+                std::size_t i = 0;
+                for (; i + 16 <= length; i += 16) {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                    const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+                    const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), _mm_unpacklo_epi8(high, low));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2 + 16), _mm_unpackhi_epi8(high, low));
+                }
+
+                hex_encode_scalar(data + i, length - i, uppercase, out + i * 2);
+            }
+
+            __attribute__((target("avx2"))) void hex_encode_avx2(const unsigned char *data, std::size_t length,
+                                                                 bool uppercase, char *out)
+            {
+                const __m256i digits = _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(uppercase ? hex_upper : hex_lower)));
+                const __m256i mask = _mm256_set1_epi8(0x0F);
+
+                std::size_t i = 0;
+                for (; i + 32 <= length; i += 32) {
+                    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                    const __m256i high =
+                        _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+                    const __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, mask));
+
+                    // unpacking works within each 128 bit lane, so the halves are put back in order
+                    const __m256i first = _mm256_unpacklo_epi8(high, low);
+                    const __m256i second = _mm256_unpackhi_epi8(high, low);
+
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 2),
+                                        _mm256_permute2x128_si256(first, second, 0x20));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 2 + 32),
+                                        _mm256_permute2x128_si256(first, second, 0x31));
+                }
+
+                hex_encode_ssse3(data + i, length - i, uppercase, out + i * 2);
+            }
+#endif
+
+            typedef void (*hex_encode_function)(const unsigned char *, std::size_t, bool, char *);
+
+            struct hex_encoder {
+                hex_encode_function function;
+                const char *name;
+            };
+
+            hex_encoder select_hex_encode()
+            {
+#ifdef CODA_KERNELS_DISPATCH
+                __builtin_cpu_init();
+
+                if (__builtin_cpu_supports("avx2")) {
+                    return hex_encoder{hex_encode_avx2, "avx2"};
+                }
+                if (__builtin_cpu_supports("ssse3")) {
+                    return hex_encoder{hex_encode_ssse3, "ssse3"};
+                }
+#endif
+                return hex_encoder{hex_encode_scalar, "scalar"};
+            }
+
+            const hex_encoder &hex_encode_implementation()
+            {
+                static const hex_encoder encoder = select_hex_encode();
+                return encoder;
+            }
+
+#ifdef CODA_KERNELS_SSE2
+            // the 16 nibbles of a value in the byte lanes of a register, most significant first
+            inline __m128i spread_nibbles(std::uint64_t value)
+            {
+                const __m128i bytes = _mm_cvtsi64_si128(static_cast<long long>(__builtin_bswap64(value)));
+                const __m128i low = _mm_and_si128(bytes, _mm_set1_epi8(0x0F));
+                const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+                return _mm_unpacklo_epi8(high, low);
+            }
+
+            // '0' + nibble, plus the distance to 'a' or 'A' for nibbles above 9
+            inline __m128i nibbles_to_ascii(__m128i nibbles, __m128i letters)
+            {
+                const __m128i above_nine = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+                const __m128i ascii = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+                return _mm_add_epi8(ascii, _mm_and_si128(above_nine, letters));
+            }
+
+            void expand_hex_sse2(const std::uint64_t *values, std::size_t count, bool uppercase, char *out)
+            {
+                const __m128i letters = _mm_set1_epi8(uppercase ? 'A' - '0' - 10 : 'a' - '0' - 10);
+
+                std::size_t i = 0;
+
+                // two values per iteration keep both halves of the pipeline busy
+                for (; i + 2 <= count; i += 2) {
+                    const __m128i first = nibbles_to_ascii(spread_nibbles(values[i]), letters);
+                    const __m128i second = nibbles_to_ascii(spread_nibbles(values[i + 1]), letters);
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), first);
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), second);
+                    out += 32;
+                }
+
+                if (i < count) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                                     nibbles_to_ascii(spread_nibbles(values[i]), letters));
+                }
+            }
+#endif
+        }
+
+        std::size_t find_escape(const char *data, std::size_t length, escape_set set)
+        {
+            std::size_t i = 0;
+
+#ifdef CODA_KERNELS_SSE2
+            // sixteen characters are compared against the whole set at once
+            switch (set) {
+                case escape_set::json:
+                    for (; i + 16 <= length; i += 16) {
+                        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                        // unsigned chars up to 0x1f are unchanged by an unsigned minimum with 0x1f
+                        const __m128i found = _mm_or_si128(
+                            _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('"')),
+                                         _mm_cmpeq_epi8(chars, _mm_set1_epi8('\\'))),
+                            _mm_cmpeq_epi8(_mm_min_epu8(chars, _mm_set1_epi8(0x1F)), chars));
+                        const int mask = _mm_movemask_epi8(found);
+                        if (mask != 0) {
+                            return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                        }
+                    }
+                    break;
+                case escape_set::html:
+                    for (; i + 16 <= length; i += 16) {
+                        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                        const __m128i found = _mm_or_si128(
+                            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('<')),
+                                                      _mm_cmpeq_epi8(chars, _mm_set1_epi8('>'))),
+                                         _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('&')),
+                                                      _mm_cmpeq_epi8(chars, _mm_set1_epi8('"')))),
+                            _mm_cmpeq_epi8(chars, _mm_set1_epi8('\'')));
+                        const int mask = _mm_movemask_epi8(found);
+                        if (mask != 0) {
+                            return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                        }
+                    }
+                    break;
+                case escape_set::csv:
+                    for (; i + 16 <= length; i += 16) {
+                        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                        const __m128i found =
+                            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(',')),
+                                                      _mm_cmpeq_epi8(chars, _mm_set1_epi8('"'))),
+                                         _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\r')),
+                                                      _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n'))));
+                        const int mask = _mm_movemask_epi8(found);
+                        if (mask != 0) {
+                            return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                        }
+                    }
+                    break;
+            }
+#endif
+
+            for (; i < length; ++i) {
+                const auto ch = static_cast<unsigned char>(data[i]);
+
+                switch (set) {
+                    case escape_set::json:
+                        if (ch == '"' || ch == '\\' || ch < 0x20) {
+                            return i;
+                        }
+                        break;
+                    case escape_set::html:
+                        if (ch == '<' || ch == '>' || ch == '&' || ch == '"' || ch == '\'') {
+                            return i;
+                        }
+                        break;
+                    case escape_set::csv:
+                        if (ch == ',' || ch == '"' || ch == '\r' || ch == '\n') {
+                            return i;
+                        }
+                        break;
+                }
+            }
+
+            return length;
+        }
+
+        std::size_t find_non_ascii(const char *data, std::size_t length)
+        {
+            std::size_t i = 0;
+
+#ifdef CODA_KERNELS_SSE2
+            // the byte mask is the high bit of each character
+            for (; i + 16 <= length; i += 16) {
+                const int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+                if (mask != 0) {
+                    return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                }
+            }
+#endif
+
+            for (; i < length; ++i) {
+                if (static_cast<unsigned char>(data[i]) > 0x7F) {
+                    return i;
+                }
+            }
+
+            return length;
+        }
+
+        std::size_t utf8_width(const char *data, std::size_t length, bool columns)
+        {
+            auto i = find_non_ascii(data, length);
+            std::size_t width = i;
+
+            while (i < length) {
+                const auto lead = static_cast<unsigned char>(data[i]);
+
+                if (lead < 0x80) {
+                    ++width;
+                    ++i;
+                    continue;
+                }
+
+                // the sequence length and payload bits of the lead byte
+                std::size_t size = 0;
+                char32_t codepoint = 0;
+                if (lead >= 0xC2 && lead <= 0xDF) {
+                    size = 2;
+                    codepoint = lead & 0x1F;
+                } else if (lead >= 0xE0 && lead <= 0xEF) {
+                    size = 3;
+                    codepoint = lead & 0x0F;
+                } else if (lead >= 0xF0 && lead <= 0xF4) {
+                    size = 4;
+                    codepoint = lead & 0x07;
+                }
+
+                std::size_t next = 1;
+                for (; next < size && i + next < length; ++next) {
+                    const auto byte = static_cast<unsigned char>(data[i + next]);
+                    if ((byte & 0xC0) != 0x80) {
+                        break;
+                    }
+                    codepoint = codepoint << 6 | (byte & 0x3F);
+                }
+
+                if (next != size || (size == 3 && codepoint < 0x800) || (size == 4 && codepoint < 0x10000) ||
+                    codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+                    // an invalid or truncated sequence, its lead byte is one character
+                    ++width;
+                    ++i;
+                    continue;
+                }
+
+                i += size;
+                width += columns ? column_width(codepoint) : 1;
+            }
+
+            return width;
+        }
+
+        void hex_encode(const unsigned char *data, std::size_t length, bool uppercase, char *out)
+        {
+            hex_encode_implementation().function(data, length, uppercase, out);
+        }
+
+        const char *hex_encode_name()
+        {
+            return hex_encode_implementation().name;
+        }
+
+        bool hex_encode_using(const char *name, const unsigned char *data, std::size_t length, bool uppercase,
+                              char *out)
+        {
+            const std::string_view which(name);
+
+            if (which == "scalar") {
+                hex_encode_scalar(data, length, uppercase, out);
+                return true;
+            }
+
+#ifdef CODA_KERNELS_DISPATCH
+            __builtin_cpu_init();
+
+            if (which == "ssse3" && __builtin_cpu_supports("ssse3")) {
+                hex_encode_ssse3(data, length, uppercase, out);
+                return true;
+            }
+            if (which == "avx2" && __builtin_cpu_supports("avx2")) {
+                hex_encode_avx2(data, length, uppercase, out);
+                return true;
+            }
+#endif
+            return false;
+        }
+
+        void expand_hex(const std::uint64_t *values, std::size_t count, bool uppercase, char *out)
+        {
+#ifdef CODA_KERNELS_SSE2
+            expand_hex_sse2(values, count, uppercase, out);
+#else
+            expand_hex_scalar(values, count, uppercase, out);
+#endif
+        }
+    }
+}
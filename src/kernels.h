@@ -0,0 +1,83 @@
+#ifndef CODA_FORMAT_KERNELS_H
+#define CODA_FORMAT_KERNELS_H
+
+// Batched conversion kernels shared by the range and byte buffer
+// conversions. Each has a portable scalar version and, where the target
+// supports it, a SIMD version producing the same bytes.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace coda
+{
+    namespace kernels
+    {
+        /*!
+         * writes every value as 16 zero padded hex digits, most significant first
+         * @param out room for 16 characters per value
+         */
+        void expand_hex(const std::uint64_t *values, std::size_t count, bool uppercase, char *out);
+
+        /*!
+         * writes two hex digits for every byte of data
+         * @param out room for 2 * length characters
+         */
+        void hex_encode(const unsigned char *data, std::size_t length, bool uppercase, char *out);
+
+        /*!
+         * @return the name of the hex_encode implementation chosen for this cpu
+         */
+        const char *hex_encode_name();
+
+        /*!
+         * hex_encode with a named implementation, "scalar", "ssse3" or "avx2"
+         * @return false if this cpu or build does not have it
+         */
+        bool hex_encode_using(const char *name, const unsigned char *data, std::size_t length, bool uppercase,
+                              char *out);
+
+        // the characters found by find_escape
+        enum class escape_set : std::uint8_t {
+            json,  // quote, backslash and control characters
+            html,  // < > & and both quotes
+            csv    // comma, quote and line breaks
+        };
+
+        /*!
+         * @return the position of the first character of data in the set, or length if there is none
+         */
+        std::size_t find_escape(const char *data, std::size_t length, escape_set set);
+
+        /*!
+         * @return the position of the first byte of data above 0x7f, or length if it is all ascii
+         */
+        std::size_t find_non_ascii(const char *data, std::size_t length);
+
+        /*!
+         * measures utf-8 text. a byte that does not start a valid sequence
+         * counts as one character.
+         * @param columns if true, east asian wide and fullwidth characters
+         * count as two and combining marks as zero
+         * @return the number of characters, or terminal columns
+         */
+        std::size_t utf8_width(const char *data, std::size_t length, bool columns);
+
+        /*!
+         * @return the number of hex digits in a value without leading zeros, at least one
+         */
+        inline std::size_t hex_length(std::uint64_t value)
+        {
+#if defined(__GNUC__)
+            return value == 0 ? 1 : static_cast<std::size_t>(67 - __builtin_clzll(value)) / 4;
+#else
+            std::size_t length = 1;
+            while (value >>= 4) {
+                ++length;
+            }
+            return length;
+#endif
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include <string>
+
+#include <bandit/bandit.h>
+#include <coda/format/basic_format.h>
+
+using namespace bandit;
+using namespace snowhouse;
+
+using coda::basic_format;
+using coda::format;
+
+using std::invalid_argument;
+using std::string;
+
+go_bandit([]() {
+    describe("basic format", []() {
+        it("renders like a format without using the heap", []() {
+            basic_format<4, 256> f("user {0} hit {1,-8} in {2:f2} ms", "bob", "/index", 12.3456);
+
+            Assert::That(f.str(), Equals(format("user {0} hit {1,-8} in {2:f2} ms", "bob", "/index", 12.3456).str()));
+            Assert::That(f.overflow(), Equals(0));
+        });
+
+        it("keeps named formats inline", []() {
+            basic_format<> f("{name} is {age} ({name})");
+            f.arg("name", "alice").arg("age", 30);
+
+            Assert::That(f.str(), Equals("alice is 30 (alice)"));
+            Assert::That(f.overflow(), Equals(0));
+        });
+
+        it("falls back to the heap when the storage is full", []() {
+            const string text(300, 'x');
+
+            basic_format<1, 16> f("{0} {1} {2} {3}", text, 1, 2, 3);
+
+            Assert::That(f.overflow(), IsGreaterThan(0));
+            Assert::That(f.str(), Equals(text + " 1 2 3"));
+        });
+
+        it("reuses its storage when rebound", []() {
+            basic_format<2, 128> f("{0}={1}");
+
+            for (int i = 0; i < 100; ++i) {
+                f.reset();
+                f.args("key", i);
+            }
+
+            Assert::That(f.str(), Equals("key=99"));
+            Assert::That(f.overflow(), Equals(0));
+        });
+
+        it("copies to and from a format", []() {
+            basic_format<> inline_format("{0}-{1}", 1);
+
+            format copied(inline_format);
+            copied.args(2);
+
+            format moved(basic_format<>("{0}+{1}", 3, 4));
+
+            basic_format<> from(copied);
+
+            Assert::That(copied.str(), Equals("1-2"));
+            Assert::That(moved.str(), Equals("3+4"));
+            Assert::That(from.str(), Equals("1-2"));
+            Assert::That(inline_format.specifiers(), Equals(1));
+        });
+
+        it("assigns without sharing storage", []() {
+            basic_format<> first("{0}", 1);
+            basic_format<> second("{0} {1}", 2, 3);
+
+            first = second;
+            second.reset();
+
+            Assert::That(first.str(), Equals("2 3"));
+            Assert::That(second.specifiers(), Equals(2));
+        });
+
+        it("reuses escaped replacements when rebound", []() {
+            basic_format<2, 256> f("{0!c},{1!j}");
+
+            for (int i = 0; i < 100; ++i) {
+                f.reset();
+                f.args("a,b", string(i % 40, '"'));
+            }
+
+            Assert::That(f.str(), Equals(format("{0!c},{1!j}", "a,b", string(99 % 40, '"')).str()));
+            Assert::That(f.overflow(), Equals(0));
+        });
+
+        it("gives back blocks freed in any order", []() {
+            coda::detail::inline_arena<128> arena;
+            auto memory = arena.memory();
+
+            auto first = memory->allocate(32);
+            auto second = memory->allocate(32);
+            auto third = memory->allocate(64);
+
+            memory->deallocate(second, 32);
+            memory->deallocate(third, 64);
+
+            // the second and third blocks are free again, so this fits after the first
+            auto larger = memory->allocate(96);
+
+            Assert::That(arena.resource.overflow(), Equals(0));
+
+            memory->deallocate(first, 32);
+            memory->deallocate(larger, 96);
+        });
+
+        it("throws on an invalid format string", []() {
+            AssertThrows(invalid_argument, basic_format<>("{0"));
+        });
+    });
+});
@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <bandit/bandit.h>
+#include <coda/format/capture.h>
+#include <coda/format/decoder.h>
+
+using namespace bandit;
+using namespace snowhouse;
+
+using coda::capture_reader;
+using coda::capture_writer;
+using coda::format;
+
+using std::invalid_argument;
+using std::length_error;
+using std::string;
+
+namespace
+{
+    const char *capture_path = "coda_format_capture.test.bin";
+}
+
+go_bandit([]() {
+    describe("a capture file", []() {
+        after_each([]() { std::remove(capture_path); });
+
+        it("decodes the text the formatter would produce", []() {
+            {
+                capture_writer writer(capture_path, 4096);
+
+                auto id = writer.define("{0} walked {1,-4} miles and saw {2:X}, {3:f2}");
+                writer.record(id, "A bear", 20, 10, 1243.4533889798);
+
+                auto signs = writer.define("{0:x} {1:x} {2:o} {3} {4}");
+                writer.record(signs, std::int16_t(-1), -1L, 8u, 'c', true);
+
+                writer.record(id, string("An eagle"), 3);
+            }
+
+            capture_reader reader(capture_path);
+            string line;
+
+            Assert::That(reader.next(line), IsTrue());
+            Assert::That(line, Equals(format("{0} walked {1,-4} miles and saw {2:X}, {3:f2}", "A bear", 20, 10,
+                                             1243.4533889798).str()));
+
+            Assert::That(reader.next(line), IsTrue());
+            Assert::That(line, Equals("ffff ffffffffffffffff 10 c 1"));
+
+            Assert::That(reader.next(line), IsTrue());
+            Assert::That(line, Equals("An eagle walked 3    miles and saw {2:X}, {3:f2}"));
+
+            Assert::That(reader.next(line), IsFalse());
+        });
+
+        it("rejects unknown templates and extra arguments", []() {
+            capture_writer writer(capture_path, 4096);
+
+            AssertThrows(invalid_argument, writer.record(0, 1));
+
+            auto id = writer.define("{0}");
+
+            AssertThrows(invalid_argument, writer.record(id, 1, 2));
+
+            AssertThrows(invalid_argument, writer.define("{0} {2}"));
+        });
+
+        it("stops recording when the file is full", []() {
+            capture_writer writer(capture_path, 32);
+
+            auto id = writer.define("{0}");
+
+            writer.record(id, 1);
+
+            AssertThrows(length_error, writer.record(id, "a string that does not fit"));
+        });
+
+        it("rejects files that are not captures", []() {
+            {
+                std::FILE *file = std::fopen(capture_path, "wb");
+                std::fputs("definitely not a capture file header", file);
+                std::fclose(file);
+            }
+
+            AssertThrows(invalid_argument, capture_reader(capture_path));
+        });
+    });
+});
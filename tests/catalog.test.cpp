@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <bandit/bandit.h>
+#include <coda/format/catalog.h>
+
+using namespace bandit;
+using namespace snowhouse;
+
+using coda::catalog_reader;
+using coda::catalog_writer;
+using coda::format;
+
+using std::invalid_argument;
+using std::string;
+
+namespace
+{
+    const char *catalog_path = "coda_format_catalog.test.bin";
+
+    string read_file(const char *path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void write_file(const char *path, const string &data)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+}
+
+go_bandit([]() {
+    describe("a catalog file", []() {
+        after_each([]() { std::remove(catalog_path); });
+
+        it("loads templates that render like parsed ones", []() {
+            {
+                catalog_writer writer;
+
+                Assert::That(writer.add("{0} walked {1,-4} miles and saw {2:X}, {3:f2}"), Equals(0u));
+                Assert::That(writer.add("{user} from {host} as {user,6}"), Equals(1u));
+                Assert::That(writer.add("no {{specifiers}}"), Equals(2u));
+                Assert::That(writer.add("at {0:t3-0230}"), Equals(3u));
+
+                writer.write(catalog_path);
+            }
+
+            catalog_reader reader(catalog_path);
+
+            Assert::That(reader.size(), Equals(4));
+
+            format walked = reader.get(0);
+            walked.args("A bear", 20, 10, 1243.4533889798);
+
+            Assert::That(walked.str(), Equals(format("{0} walked {1,-4} miles and saw {2:X}, {3:f2}", "A bear", 20,
+                                                     10, 1243.4533889798).str()));
+
+            format named = reader.get(1);
+
+            Assert::That(named.specifiers(), Equals(2));
+
+            named.arg("host", "db1").arg("user", "root");
+
+            Assert::That(named.str(), Equals("root from db1 as   root"));
+            Assert::That(reader.get(2).str(), Equals("no {specifiers}"));
+
+            format stamped = reader.get(3);
+            stamped.args(std::chrono::system_clock::time_point(std::chrono::seconds(1714566896)));
+
+            Assert::That(stamped.str(), Equals("at 2024-05-01T10:04:56.000-02:30"));
+
+            format unbound = reader.get(0);
+            unbound.reset();
+
+            Assert::That(unbound.str(), Equals("{0} walked {1,-4} miles and saw {2:X}, {3:f2}"));
+        });
+
+        it("rejects unknown ids and invalid templates", []() {
+            catalog_writer writer;
+
+            AssertThrows(invalid_argument, writer.add("{1}"));
+
+            writer.write(catalog_path);
+
+            catalog_reader reader(catalog_path);
+
+            Assert::That(reader.size(), Equals(0));
+            AssertThrows(invalid_argument, reader.get(0));
+        });
+
+        it("rejects incompatible files", []() {
+            write_file(catalog_path, "not a catalog");
+
+            AssertThrows(invalid_argument, catalog_reader(catalog_path));
+
+            catalog_writer writer;
+            writer.add("{0}");
+            writer.write(catalog_path);
+
+            auto data = read_file(catalog_path);
+            data[8] = static_cast<char>(data[8] + 1);  // version
+            write_file(catalog_path, data);
+
+            AssertThrows(invalid_argument, catalog_reader(catalog_path));
+
+            writer.write(catalog_path);
+            write_file(catalog_path, read_file(catalog_path).substr(0, 40));
+
+            AssertThrows(invalid_argument, catalog_reader(catalog_path));
+        });
+
+        it("rejects corrupt templates without reading out of bounds", []() {
+            catalog_writer writer;
+            writer.add("{name,-8:f2} and {other:x} then {name}");
+            writer.write(catalog_path);
+
+            const auto original = read_file(catalog_path);
+
+            // the header and index are checked when opening
+            for (std::size_t pos = sizeof(coda::catalog::header); pos < original.size() - 16; ++pos) {
+                for (const char value : {'\0', '\x7f', '\xff'}) {
+                    auto data = original;
+                    data[pos] = value;
+                    write_file(catalog_path, data);
+
+                    catalog_reader reader(catalog_path);
+
+                    try {
+                        format f = reader.get(0);
+                        f.args(1.5, 2, 3.5);
+                        f.str();
+                        f.refresh();
+                    } catch (const invalid_argument &) {
+                    }
+                }
+            }
+        });
+    });
+});
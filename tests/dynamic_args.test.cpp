@@ -0,0 +1,129 @@
+#include <cstdint>
+#include <string>
+
+#include <bandit/bandit.h>
+#include <coda/format/dynamic_args.h>
+
+using namespace bandit;
+using namespace snowhouse;
+
+using coda::dynamic_args;
+using coda::format;
+
+using std::invalid_argument;
+using std::string;
+
+go_bandit([]() {
+    describe("dynamic arguments", []() {
+        it("binds every stored argument in one call", []() {
+            dynamic_args row;
+
+            row.push_back("alice").push_back(42).push_back(1.5).push_back(true).push_back('x');
+
+            Assert::That(row.size(), Equals(5));
+
+            format f("{0} {1,4} {2:f2} {3} {4}");
+            f.args(row);
+
+            Assert::That(f.specifiers(), Equals(0));
+            Assert::That(f.str(), Equals("alice   42 1.50 1 x"));
+        });
+
+        it("renders like arguments of the same types", []() {
+            const string text = "row";
+            const std::int16_t small = -2;
+            const std::uint64_t large = 18446744073709551615ULL;
+            const float ratio = 0.1f;
+
+            dynamic_args row;
+            row.push_back(text).push_back(small).push_back(small).push_back(large).push_back(ratio);
+
+            format stored("{0} {1} {2:x} {3} {4}");
+            stored.args(row);
+
+            Assert::That(stored.str(), Equals(format("{0} {1} {2:x} {3} {4}", text, small, small, large, ratio).str()));
+        });
+
+        it("copies strings and keeps them after the source changes", []() {
+            dynamic_args row;
+
+            string name = "first";
+            row.push_back(name).push_back(std::string_view("second"));
+            name = "changed";
+
+            Assert::That(format("{0} {1}").args(row).str(), Equals("first second"));
+        });
+
+        it("continues after arguments already bound", []() {
+            dynamic_args rest;
+            rest.push_back(2).push_back(3);
+
+            format f("{0}-{1}-{2}");
+            f.args(1).args(rest);
+
+            Assert::That(f.str(), Equals("1-2-3"));
+        });
+
+        it("binds nothing when there are too many arguments", []() {
+            dynamic_args row;
+            row.push_back(1).push_back(2);
+
+            format f("{0}");
+
+            AssertThrows(invalid_argument, f.args(row));
+            Assert::That(f.specifiers(), Equals(1));
+        });
+
+        it("binds nothing when an argument does not suit its specifier", []() {
+            dynamic_args row;
+            row.push_back(1).push_back(2).push_back(3);
+
+            format f("{0}-{1}-{2:t}");
+
+            AssertThrows(invalid_argument, f.args(row));
+            Assert::That(f.specifiers(), Equals(3));
+            Assert::That(f.str(), Equals("{0}-{1}-{2:t}"));
+
+            f.args(4, 5);
+            Assert::That(f.str(), Equals("4-5-{2:t}"));
+        });
+
+        it("restores arguments bound by name when a later one fails", []() {
+            dynamic_args row;
+            row.push_back(1).push_back("x").push_back(3);
+
+            format f("{a} {b,3} {c:t} {b}");
+            f.arg("b", 2.5);
+
+            AssertThrows(invalid_argument, f.args(row));
+            Assert::That(f.specifiers(), Equals(2));
+            Assert::That(f.str(), Equals("{a} 2.5 {c:t} 2.5"));
+        });
+
+        it("rejects a null string", []() {
+            dynamic_args row;
+            row.push_back(1);
+
+            const char *missing = nullptr;
+
+            AssertThrows(invalid_argument, row.push_back(missing));
+            Assert::That(row.size(), Equals(1));
+        });
+
+        it("can be cleared and reused", []() {
+            dynamic_args row;
+            row.reserve(2, 16);
+
+            format f("{0},{1}");
+
+            row.push_back("a").push_back(1);
+            Assert::That(format(f).args(row).str(), Equals("a,1"));
+
+            row.clear();
+            Assert::That(row.empty(), IsTrue());
+
+            row.push_back("b").push_back(2);
+            Assert::That(format(f).args(row).str(), Equals("b,2"));
+        });
+    });
+});
@@ -5,10 +5,19 @@
  * requires the Igloo C++ Unit Testing Library
  * http://igloo-testing.org
  */
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <locale>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include <bandit/bandit.h>
 #include "format.h"
+#include "kernels.h"
 
 using namespace bandit;
 
@@ -41,6 +50,99 @@ ostream &operator<<(ostream &out, const OStreamClass &obj)
     return out;
 }
 
+// a type written with operator<< in one formatted output, so the stream pads it whole
+struct StreamedNumber {
+    int value;
+};
+
+ostream &operator<<(ostream &out, const StreamedNumber &number)
+{
+    return out << number.value;
+}
+
+class NestedClass
+{
+    friend ostream &operator<<(ostream &out, const NestedClass &obj);
+
+   private:
+    int data;
+
+   public:
+    explicit NestedClass(int data) : data(data)
+    {
+    }
+};
+
+ostream &operator<<(ostream &out, const NestedClass &obj)
+{
+    out << "[" << format("{0:x}", obj.data).str() << "]";
+    return out;
+}
+
+// writes a value through operator<<, so it takes the stream path
+template <typename T>
+struct Streamed {
+    T value;
+};
+
+template <typename T>
+ostream &operator<<(ostream &out, const Streamed<T> &obj)
+{
+    out << obj.value;
+    return out;
+}
+
+// a locale writing 1234567.5 as 1.234.567,5
+struct GroupedNumbers : std::numpunct<char> {
+    char do_decimal_point() const override
+    {
+        return ',';
+    }
+
+    char do_thousands_sep() const override
+    {
+        return '.';
+    }
+
+    std::string do_grouping() const override
+    {
+        return "\3";
+    }
+};
+
+// sets the global locale for a scope
+class GlobalLocale
+{
+   public:
+    explicit GlobalLocale(const std::locale &locale) : previous_(std::locale::global(locale))
+    {
+    }
+
+    ~GlobalLocale()
+    {
+        std::locale::global(previous_);
+    }
+
+   private:
+    std::locale previous_;
+};
+
+// every conversion and width of a value renders as the stream would
+template <typename T>
+void assert_streamed(const T &value)
+{
+    static const char *types[] = {"", ":f0", ":f2", ":F6", ":e3", ":E2", ":x", ":X", ":o", ":O", ":n"};
+    static const char *widths[] = {"", ",5", ",-7", ",24"};
+
+    for (const auto type : types) {
+        for (const auto width : widths) {
+            const string spec = string("{0") + width + type + "}";
+
+            Assert::That(format(spec, value).str(), Equals(format(spec, Streamed<T>{value}).str()));
+        }
+    }
+}
+
 go_bandit([]() {
 
     describe("a formatter", []() {
@@ -290,6 +392,18 @@ go_bandit([]() {
 
         });
 
+        it("does not leak stream formatting between arguments", []() {
+            format f("{0:X} {1} {2:f2} {3}", 10, 1.0e-10, 1.5, 2.25);
+
+            Assert::That(f.str(), Equals("0A 1e-10 1.50 2.25"));
+        });
+
+        it("can format arguments that format internally", []() {
+            format f("{0} {1:X}", NestedClass(255), 171);
+
+            Assert::That(f.str(), Equals("[ff] AB"));
+        });
+
         it("can print to a stream", []() {
 
             stringstream buf;
@@ -301,6 +415,41 @@ go_bandit([]() {
             Assert::That(buf.str(), Equals("format is so cool!"));
         });
 
+        it("renders unbound specifiers where they appear", []() {
+            format f("{2} saw {0} {1}!");
+
+            f.args(20, "eagles");
+
+            Assert::That(f.str(), Equals("{2} saw 20 eagles!"));
+
+            f.args("A bear");
+
+            Assert::That(f.str(), Equals("A bear saw 20 eagles!"));
+        });
+
+        it("can write to a fixed buffer", []() {
+            format f("{0} is so {1}!", "format", "cool");
+
+            char buf[32];
+
+            Assert::That(f.format_to(buf, sizeof(buf)), Equals(18));
+            Assert::That(string(buf, 18), Equals("format is so cool!"));
+
+            char small[6];
+
+            Assert::That(f.format_to(small, sizeof(small)), Equals(18));
+            Assert::That(string(small, sizeof(small)), Equals("format"));
+        });
+
+        it("can append several formats to one string", []() {
+            string out = "> ";
+
+            format("{0,3}|", 1).append_to(out);
+            format("{0:x}|", 255).append_to(out);
+
+            Assert::That(out, Equals(">   1|ff|"));
+        });
+
         it("can left shift to a stream", []() {
 
             format f("{0} is so {1}!", "format", "cool");
@@ -359,6 +508,569 @@ go_bandit([]() {
             Assert::That(f.str(), Equals("hello\n"));
         });
 
+        it("can format a range as one argument", []() {
+            std::vector<int> values{1, -20, 300};
+
+            Assert::That(format("[{0}]", join(values)).str(), Equals("[1, -20, 300]"));
+            Assert::That(format("[{0,4}]", join(values, "|")).str(), Equals("[   1| -20| 300]"));
+            Assert::That(format("[{0,4:x}]", join(values, " ")).str(), Equals("[0001 ffffffec 012c]"));
+            Assert::That(format("[{0:o}]", join(values, " ")).str(), Equals("[1 37777777754 454]"));
+            Assert::That(format("[{0}]", join(std::vector<int>())).str(), Equals("[]"));
+
+            std::vector<short> shorts{-1, 255};
+
+            Assert::That(format("{0:X}", join(shorts, " ")).str(), Equals("FFFF FF"));
+
+            std::vector<std::uint64_t> wide{0, 0xFEDCBA9876543210ULL, 18446744073709551615ULL};
+
+            Assert::That(format("{0:x}", join(wide, " ")).str(), Equals("00 fedcba9876543210 ffffffffffffffff"));
+            Assert::That(format("{0}", join(wide, " ")).str(), Equals("0 18364758544493064720 18446744073709551615"));
+
+            const double doubles[] = {1.5, -0.25};
+
+            Assert::That(format("{0,7:f2}", join(doubles)).str(), Equals("   1.50,   -0.25"));
+            Assert::That(format("{0:n}", join(doubles, "; ")).str(), Equals("1.5; -0.25\n"));
+
+            std::list<std::string> names{"a", "bc"};
+
+            Assert::That(format("{0,3}", join(names, ",")).str(), Equals("  a, bc"));
+        });
+
+        it("formats every element of a large range", []() {
+            std::vector<unsigned> values(200);
+            std::string hex;
+            std::string decimal;
+
+            for (unsigned i = 0; i < values.size(); ++i) {
+                values[i] = i * 2654435761u;
+
+                std::ostringstream buf;
+                buf << std::hex << values[i];
+                hex += (i ? "," : "") + (values[i] < 16 ? "0" + buf.str() : buf.str());
+                decimal += (i ? "," : "") + std::to_string(values[i]);
+            }
+
+            Assert::That(format("{0:x}", join(values, ",")).str(), Equals(hex));
+            Assert::That(format("{0}", join(values, ",")).str(), Equals(decimal));
+        });
+
+        it("can format a byte buffer as hex", []() {
+            std::vector<std::uint8_t> bytes{0xde, 0xad, 0xbe, 0xef, 0x01};
+
+            Assert::That(format("{0}", bytes).str(), Equals("deadbeef01"));
+            Assert::That(format("{0:H}", bytes).str(), Equals("DEADBEEF01"));
+            Assert::That(format("{0:h2}", bytes).str(), Equals("dead beef 01"));
+            Assert::That(format("{0:H1-}", bytes).str(), Equals("DE-AD-BE-EF-01"));
+            Assert::That(format("[{0,12:h}]", bytes).str(), Equals("[  deadbeef01]"));
+            Assert::That(format("{0:h4}", string("abcde")).str(), Equals("61626364 65"));
+            Assert::That(format("[{0:h}]", std::vector<std::uint8_t>()).str(), Equals("[]"));
+
+            const std::byte key[] = {std::byte{0}, std::byte{0xff}};
+
+            Assert::That(format("{0:h}", key).str(), Equals("00ff"));
+        });
+
+        it("can format byte buffers of any length as hex", []() {
+            std::vector<unsigned char> bytes;
+            string expected;
+
+            for (int length = 0; length < 300; ++length) {
+                Assert::That(format("{0}", bytes).str(), Equals(expected));
+
+                bytes.push_back(static_cast<unsigned char>(length * 37));
+
+                char digits[3];
+                std::snprintf(digits, sizeof(digits), "%02x", bytes.back());
+                expected += digits;
+            }
+
+            string grouped;
+            for (std::size_t i = 0; i < expected.size(); i += 6) {
+                grouped += (i ? "." : "") + expected.substr(i, 6);
+            }
+
+            Assert::That(format("{0:h3.}", bytes).str(), Equals(grouped));
+        });
+
+        it("renders character arrays as strings unless dumped", []() {
+            const unsigned char text[] = "hi";
+            const signed char other[] = "ok";
+
+            Assert::That(format("{0}", text).str(), Equals("hi"));
+            Assert::That(format("{0,4}", other).str(), Equals("  ok"));
+            Assert::That(format("{0:h}", text).str(), Equals("686900"));
+        });
+
+        it("encodes hex the same with every kernel", []() {
+            std::vector<unsigned char> bytes;
+            for (int i = 0; i < 700; ++i) {
+                bytes.push_back(static_cast<unsigned char>(i * 131 + 7));
+            }
+
+            for (const bool uppercase : {false, true}) {
+                for (std::size_t length = 0; length <= bytes.size(); ++length) {
+                    string expected(length * 2, '\0');
+                    kernels::hex_encode_using("scalar", bytes.data(), length, uppercase, &expected[0]);
+
+                    for (const char *name : {"ssse3", "avx2"}) {
+                        string actual(length * 2, '\0');
+                        if (kernels::hex_encode_using(name, bytes.data(), length, uppercase, &actual[0])) {
+                            Assert::That(actual, Equals(expected));
+                        }
+                    }
+
+                    string chosen(length * 2, '\0');
+                    kernels::hex_encode(bytes.data(), length, uppercase, &chosen[0]);
+                    Assert::That(chosen, Equals(expected));
+                }
+            }
+        });
+
+        it("throws for an invalid hex dump", []() {
+            AssertThrows(invalid_argument, format("{0:h}", 10));
+            AssertThrows(invalid_argument, format("{0:h}", 1.5));
+            AssertThrows(invalid_argument, format("{0:hx}", "ab"));
+            AssertThrows(invalid_argument, format("{0:h200}", "ab"));
+            AssertThrows(invalid_argument, format("{0:h2--}", "ab"));
+        });
+
+        it("can format a time point as iso 8601", []() {
+            using namespace std::chrono;
+
+            // 2024-05-01 12:34:56.123456789 UTC
+            const system_clock::time_point second(seconds(1714566896));
+            const auto time = time_point_cast<nanoseconds>(second) + nanoseconds(123456789);
+
+            Assert::That(format("{0:t}", time).str(), Equals("2024-05-01T12:34:56Z"));
+            Assert::That(format("{0:t3}", time).str(), Equals("2024-05-01T12:34:56.123Z"));
+            Assert::That(format("{0:t6}", time).str(), Equals("2024-05-01T12:34:56.123456Z"));
+            Assert::That(format("{0:t9}", time).str(), Equals("2024-05-01T12:34:56.123456789Z"));
+            Assert::That(format("{0:t1}", second).str(), Equals("2024-05-01T12:34:56.0Z"));
+            Assert::That(format("{0}", time).str(), Equals("2024-05-01T12:34:56Z"));
+            Assert::That(format("[{0,-22:t}]", second).str(), Equals("[2024-05-01T12:34:56Z  ]"));
+        });
+
+        it("can format a time point with a fixed offset", []() {
+            using namespace std::chrono;
+
+            const system_clock::time_point time(seconds(1714566896));
+
+            Assert::That(format("{0:t+0530}", time).str(), Equals("2024-05-01T18:04:56+05:30"));
+            Assert::That(format("{0:t3-1300}", time).str(), Equals("2024-04-30T23:34:56.000-13:00"));
+            Assert::That(format("{0:t+0000}", time).str(), Equals("2024-05-01T12:34:56+00:00"));
+        });
+
+        it("can format time points in the same second and before the epoch", []() {
+            using namespace std::chrono;
+
+            format f("{0:t3}");
+            const system_clock::time_point time(seconds(1714566896));
+
+            for (int i = 0; i < 3; ++i) {
+                f.arg(0, time + milliseconds(i * 7));
+            }
+            Assert::That(f.str(), Equals("2024-05-01T12:34:56.014Z"));
+
+            f.arg(0, system_clock::time_point(milliseconds(-1)));
+            Assert::That(f.str(), Equals("1969-12-31T23:59:59.999Z"));
+
+            f.arg(0, system_clock::time_point(seconds(951782400)));
+            Assert::That(f.str(), Equals("2000-02-29T00:00:00.000Z"));
+        });
+
+        it("throws for an invalid time", []() {
+            const std::chrono::system_clock::time_point time;
+
+            AssertThrows(invalid_argument, format("{0:t}", 10));
+            AssertThrows(invalid_argument, format("{0:t}", "text"));
+            AssertThrows(invalid_argument, format("{0:t12}", time));
+            AssertThrows(invalid_argument, format("{0:t+2400}", time));
+            AssertThrows(invalid_argument, format("{0:t3Z}", time));
+            AssertThrows(invalid_argument, format("{0:x}", time));
+        });
+
+        it("pads utf-8 text by bytes unless asked otherwise", []() {
+            Assert::That(format("[{0,6}]", "h\xc3\xa9llo").str(), Equals("[h\xc3\xa9llo]"));
+
+            format f("[{0,6}]");
+            f.measure(format::width_unit::codepoints).args("h\xc3\xa9llo");
+
+            Assert::That(f.str(), Equals("[ h\xc3\xa9llo]"));
+        });
+
+        it("can pad by terminal columns", []() {
+            // two wide ideographs, an emoji and a combining accent
+            format cjk("[{0,-6}]");
+            cjk.measure(format::width_unit::columns).args("\xe6\x97\xa5\xe6\x9c\xac");
+            Assert::That(cjk.str(), Equals("[\xe6\x97\xa5\xe6\x9c\xac  ]"));
+
+            format emoji("[{0,4}]");
+            emoji.measure(format::width_unit::columns).args("\xf0\x9f\x91\x8d");
+            Assert::That(emoji.str(), Equals("[  \xf0\x9f\x91\x8d]"));
+
+            format accent("[{0,3}|{1,3}]");
+            accent.measure(format::width_unit::columns).args("e\xcc\x81", 7);
+            Assert::That(accent.str(), Equals("[  e\xcc\x81|  7]"));
+
+            format codepoints("[{0,3}]");
+            codepoints.measure(format::width_unit::codepoints).args("e\xcc\x81");
+            Assert::That(codepoints.str(), Equals("[ e\xcc\x81]"));
+        });
+
+        it("pads streamed and invalid utf-8 values by display width", []() {
+            format streamed("[{0,-8}]");
+            streamed.measure(format::width_unit::columns).args(OStreamClass("\xe6\x97\xa5", 1));
+            Assert::That(streamed.str(), Equals("[\xe6\x97\xa5:1    ]"));
+
+            // a stray continuation byte and each byte of a truncated sequence count as one
+            format invalid("[{0,4}]");
+            invalid.measure(format::width_unit::codepoints).args("\x80\xe6\x97");
+            Assert::That(invalid.str(), Equals("[ \x80\xe6\x97]"));
+        });
+
+        it("pads streamed values the same in every width unit", []() {
+            const auto units = {format::width_unit::bytes, format::width_unit::codepoints, format::width_unit::columns};
+
+            for (const auto unit : units) {
+                format f("[{0:x}|{1,4:X}|{2,-5}]");
+                f.measure(unit).args(StreamedNumber{10}, StreamedNumber{255}, StreamedNumber{7});
+
+                Assert::That(f.str(), Equals("[0a|00FF|7    ]"));
+            }
+        });
+
+        it("can escape arguments for json", []() {
+            format f("{{\"name\":\"{0!j}\",\"id\":{1}}}", "say \"hi\"\\\n\x01", 7);
+
+            Assert::That(f.str(), Equals("{\"name\":\"say \\\"hi\\\"\\\\\\n\\u0001\",\"id\":7}"));
+
+            const string plain(100, 'a');
+
+            Assert::That(format("{0!j}", plain).str(), Equals(plain));
+            Assert::That(format("{0!j}", plain + "\"").str(), Equals(plain + "\\\""));
+        });
+
+        it("can escape arguments for html and csv", []() {
+            Assert::That(format("<b>{0!h}</b>", "a<b> & 'c' \"d\"").str(),
+                         Equals("<b>a&lt;b&gt; &amp; &#39;c&#39; &quot;d&quot;</b>"));
+
+            Assert::That(format("{0!c},{1!c},{2,4!c:f1}", "plain", "a,\"b\"", 1.5).str(),
+                         Equals("plain,\"a,\"\"b\"\"\", 1.5"));
+            Assert::That(format("{0!c}", "line\nbreak").str(), Equals("\"line\nbreak\""));
+        });
+
+        it("pads the escaped value to the width", []() {
+            Assert::That(format("{0,8!c}", "a,b").str(), Equals("   \"a,b\""));
+            Assert::That(format("{0,-6!j}|", "q\"").str(), Equals("q\\\"   |"));
+            Assert::That(format("[{0,6!h}]", "<").str(), Equals("[  &lt;]"));
+            Assert::That(format("{0,5!j:n}", "a\tb").str(), Equals(" a\\tb\n"));
+
+            format f("{0,6}");
+            f.escape(format::escaping::csv).args(12);
+
+            Assert::That(f.str(), Equals("    12"));
+
+            Assert::That(format("{0!j:x}", 10).str(), Equals(format("{0:x}", 10).str()));
+            Assert::That(format("{0!j:x}|{1,4!c:X}|{2,-4!h:x}|", 10, 255, 1).str(),
+                         Equals(format("{0:x}|{1,4:X}|{2,-4:x}|", 10, 255, 1).str()));
+        });
+
+        it("can escape every argument of a format by default", []() {
+            AssertThrows(invalid_argument, format("{0!x}"));
+            AssertThrows(invalid_argument, format("{0!jj}"));
+            AssertThrows(invalid_argument, format("{0!}"));
+
+            format csv("{0},{1!n},{2}");
+            csv.escape(format::escaping::csv).args("a,b", "c,d", "e");
+
+            Assert::That(csv.str(), Equals("\"a,b\",c,d,e"));
+
+            format named("{first!h} {last}");
+            named.escape(format::escaping::json).arg("first", "<\"").arg("last", "<\"");
+
+            Assert::That(named.str(), Equals("&lt;&quot; <\\\""));
+        });
+
+        it("can refresh only the arguments that changed", []() {
+            format f("cpu {0,3}% mem {1,3}% up {2}", 5, 40, "1h");
+            std::vector<format::range> changed;
+
+            Assert::That(string(f.refresh(&changed)), Equals("cpu   5% mem  40% up 1h"));
+            Assert::That(changed.size(), Equals(1));
+            Assert::That(changed[0].offset, Equals(0));
+            Assert::That(changed[0].length, Equals(23));
+
+            f.arg(1, 41).arg(0, 5);
+
+            Assert::That(string(f.refresh(&changed)), Equals("cpu   5% mem  41% up 1h"));
+            Assert::That(changed.size(), Equals(1));
+            Assert::That(changed[0].offset, Equals(13));
+            Assert::That(changed[0].length, Equals(3));
+
+            f.arg(2, "10h");
+
+            Assert::That(string(f.refresh(&changed)), Equals("cpu   5% mem  41% up 10h"));
+            Assert::That(changed.size(), Equals(1));
+            Assert::That(changed[0].offset, Equals(21));
+            Assert::That(changed[0].length, Equals(3));
+
+            Assert::That(string(f.refresh(&changed)), Equals(f.str()));
+            Assert::That(changed.empty(), IsTrue());
+        });
+
+        it("shifts the output when a refreshed argument changes length", []() {
+            format f("{0} and {1} and {2}", "a", "b", "c");
+
+            f.refresh();
+            f.arg(0, "first").arg(2, "third");
+
+            std::vector<format::range> changed;
+
+            Assert::That(string(f.refresh(&changed)), Equals("first and b and third"));
+            Assert::That(changed.size(), Equals(1));
+            Assert::That(changed[0].offset, Equals(0));
+            Assert::That(changed[0].length, Equals(21));
+
+            f.arg(1, "");
+
+            Assert::That(string(f.refresh(&changed)), Equals("first and  and third"));
+            Assert::That(changed[0].offset, Equals(10));
+
+            f.reset();
+
+            Assert::That(string(f.refresh()), Equals("{0} and {1} and {2}"));
+        });
+
+        it("converts numbers as the stream does", []() {
+            for (const int value : {0, 1, -1, 42, -123456, 2147483647}) {
+                assert_streamed(value);
+            }
+            for (const long long value : {-9223372036854775807LL - 1, 9223372036854775807LL}) {
+                assert_streamed(value);
+            }
+            for (const unsigned value : {0u, 7u, 4294967295u}) {
+                assert_streamed(value);
+            }
+            assert_streamed(static_cast<short>(-300));
+            assert_streamed(static_cast<unsigned long long>(18446744073709551615ULL));
+            assert_streamed(true);
+
+            for (const double value : {0.0, -0.0, 1.0, -0.5, 3.14159265358979, 1e20, 1.5e-7, 123456789.125}) {
+                assert_streamed(value);
+            }
+            for (const float value : {0.1f, -2.75f, 3e10f}) {
+                assert_streamed(value);
+            }
+        });
+
+        it("writes numbers with the global locale", []() {
+            GlobalLocale scope(std::locale(std::locale::classic(), new GroupedNumbers()));
+
+            Assert::That(format("{0} {1:f2}", 1234567, 3.5).str(), Equals("1.234.567 3,50"));
+            Assert::That(format("{0,10}", -1234).str(), Equals("    -1.234"));
+        });
+
+        it("writes joined numbers with the global locale", []() {
+            GlobalLocale scope(std::locale(std::locale::classic(), new GroupedNumbers()));
+
+            const std::vector<int> integers = {1234567, -2000};
+            const std::vector<double> reals = {3.5, 1234.25};
+
+            Assert::That(format("{0} {1:f2}", join(integers), join(reals, " ")).str(),
+                         Equals("1.234.567, -2.000 3,50 1.234,25"));
+            Assert::That(format("[{0,7}]", join(integers, "|")).str(), Equals("[1.234.567| -2.000]"));
+        });
+
+        it("writes numbers in the classic locale again once it is restored", []() {
+            {
+                GlobalLocale scope(std::locale(std::locale::classic(), new GroupedNumbers()));
+                format("{0}", Streamed<int>{1});
+            }
+
+            Assert::That(format("{0} {1:f2} {2}", 1234567, 3.5, Streamed<int>{1234}).str(),
+                         Equals("1234567 3.50 1234"));
+        });
+
+        it("renders a format argument in place", []() {
+            format inner("{0}={1}");
+            format outer("[{0}]", inner);
+
+            inner.args("a", 1);
+
+            Assert::That(outer.str(), Equals("[a=1]"));
+
+            inner.arg(1, 2);
+
+            char buffer[16];
+            const auto length = outer.format_to(buffer, sizeof(buffer));
+
+            Assert::That(string(buffer, length), Equals("[a=2]"));
+        });
+
+        it("pads a format argument", []() {
+            format inner("{0}", "ab");
+
+            Assert::That(format("[{0,6}] [{1,-6}] [{2,1}]", inner, inner, inner).str(), Equals("[    ab] [ab    ] [ab]"));
+
+            format wide("{0}", "日本");
+            format columns("[{0,6}]");
+            columns.measure(format::width_unit::columns).args(wide);
+
+            Assert::That(columns.str(), Equals("[  日本]"));
+        });
+
+        it("renders nested formats in one pass", []() {
+            format leaf("{0}", 1);
+            format middle("({0,4})", leaf);
+            format outer("<{0,-8}|{1}>", middle, leaf);
+
+            stringstream buf;
+            outer.print(buf);
+
+            Assert::That(buf.str(), Equals("<(   1)  |1>"));
+            Assert::That(outer.str(), Equals(buf.str()));
+        });
+
+        it("copies a temporary format argument", []() {
+            format outer("<{0}>", format("{0}", 1));
+
+            outer.arg(0, format("{0}+{1}", 2, 3));
+
+            Assert::That(outer.str(), Equals("<2+3>"));
+        });
+
+        it("copies a temporary format argument passed with operator<<", []() {
+            format outer("<{0}|{1}>");
+
+            outer << format("inner {0}", 42) << format("{0}", 7);
+
+            Assert::That(outer.str(), Equals("<inner 42|7>"));
+        });
+
+        it("copies an escaped format argument", []() {
+            format inner("{0}", "\"quoted\"");
+            format outer("{0}");
+
+            outer.escape(format::escaping::json).args(inner);
+            inner.reset();
+
+            Assert::That(outer.str(), Equals("\\\"quoted\\\""));
+        });
+
+        it("copies a format argument that refers back to the format", []() {
+            format first("({0})");
+            format second("[{0}]");
+
+            first.args(second);
+            second.args(first);
+
+            Assert::That(second.str(), Equals("[([{0}])]"));
+            Assert::That(first.str(), Equals("([([{0}])])"));
+
+            format self("<{0}>");
+            self.args(self);
+
+            Assert::That(self.str(), Equals("<<{0}>>"));
+        });
+
+        it("copies a format argument that would show the format it is assigned to", []() {
+            format a("a{0}"), b("b{0}"), c(b);
+
+            a.args(c);
+            b.args(a);
+            c = b;
+
+            Assert::That(c.str(), Equals("bab{0}"));
+            Assert::That(a.str(), Equals("abab{0}"));
+            Assert::That(b.str(), Equals("babab{0}"));
+
+            format d("d{0}"), e("e{0}"), f("f{0}");
+
+            d.args(f);
+            e.args(d);
+            f = std::move(e);
+
+            Assert::That(f.str(), Equals("edf{0}"));
+            Assert::That(d.str(), Equals("dedf{0}"));
+        });
+
+        it("leaves a moved format empty", []() {
+            format inner("inner {0}", 1);
+            format outer("[{0}]", inner);
+
+            format moved(std::move(inner));
+
+            Assert::That(moved.str(), Equals("inner 1"));
+            Assert::That(inner.specifiers(), Equals(0));
+            Assert::That(inner.str(), Equals(""));
+            Assert::That(outer.str(), Equals("[]"));
+
+            inner.reset();
+            Assert::That(inner.str(), Equals(""));
+
+            format assigned("{0}");
+            assigned = std::move(moved);
+
+            Assert::That(assigned.str(), Equals("inner 1"));
+            Assert::That(moved.str(), Equals(""));
+        });
+
+        it("pads nested formats in the unit of each format", []() {
+            // each level pads what is below it, so the widths add up from the innermost
+            format innermost("{0}", "\xc3\xa9");
+            format middle("({0,4})", innermost);
+            format outer("[{0,-9}]", middle);
+
+            Assert::That(outer.str(), Equals("[(  \xc3\xa9)   ]"));
+
+            // the outer unit measures the middle, which pads in its own unit
+            outer.measure(format::width_unit::codepoints);
+            Assert::That(outer.str(), Equals("[(  \xc3\xa9)    ]"));
+
+            middle.measure(format::width_unit::codepoints);
+            Assert::That(outer.str(), Equals("[(   \xc3\xa9)   ]"));
+
+            format chain("{0}", 0);
+            std::vector<format> levels;
+            levels.reserve(64);
+            levels.emplace_back("{0,2}", 1);
+            for (int i = 1; i < 64; ++i) {
+                levels.emplace_back("<{0,-3}>");
+                levels.back().arg(0, levels[i - 1]);
+            }
+
+            string expected = " 1";
+            for (int i = 1; i < 64; ++i) {
+                expected = "<" + expected + (expected.size() < 3 ? string(3 - expected.size(), ' ') : "") + ">";
+            }
+
+            Assert::That(levels.back().str(), Equals(expected));
+        });
+
+        it("refreshes when a format argument changes", []() {
+            format inner("{0}", 1);
+            format outer("x {0} y", inner);
+
+            Assert::That(string(outer.refresh()), Equals("x 1 y"));
+
+            inner.arg(0, 22);
+
+            std::vector<format::range> changed;
+
+            Assert::That(string(outer.refresh(&changed)), Equals("x 22 y"));
+            Assert::That(changed.size(), Equals(1));
+            Assert::That(changed[0].offset, Equals(2));
+        });
+
+        it("rebinds a format argument to a value", []() {
+            format inner("{0}", 1);
+            format outer("{0}", inner);
+
+            outer.arg(0, "plain");
+            inner.arg(0, 2);
+
+            Assert::That(outer.str(), Equals("plain"));
+        });
     });
 
 
@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <bandit/bandit.h>
+#include <coda/format/format.h>
+
+using namespace bandit;
+using namespace snowhouse;
+
+using coda::format;
+using coda::format_sink;
+
+using std::invalid_argument;
+using std::string;
+
+namespace
+{
+    struct price {
+        std::int64_t cents;
+    };
+
+    struct identifier {
+        std::uint32_t value;
+    };
+
+    struct code {
+        std::uint32_t value;
+    };
+
+    std::ostream &operator<<(std::ostream &out, const identifier &)
+    {
+        return out << "streamed";
+    }
+}
+
+namespace coda
+{
+    template <>
+    struct formatter<price> {
+        bool currency = false;
+
+        void parse(char type, std::string_view argument)
+        {
+            if (type != '\0' && type != '$') {
+                throw std::invalid_argument("invalid price format");
+            }
+            if (!argument.empty()) {
+                throw std::invalid_argument("invalid price format");
+            }
+            currency = type == '$';
+        }
+
+        void format(const price &value, format_sink &out) const
+        {
+            if (currency) {
+                out.push_back('$');
+            }
+            out.append(std::to_string(value.cents / 100));
+            out.push_back('.');
+
+            const auto cents = value.cents % 100;
+            out.push_back(static_cast<char>('0' + cents / 10));
+            out.push_back(static_cast<char>('0' + cents % 10));
+        }
+    };
+
+    // a parse hook taking a std::string, as it did before it took a view
+    template <>
+    struct formatter<code> {
+        bool hex = false;
+
+        void parse(char type, const std::string &)
+        {
+            hex = type == 'x';
+        }
+
+        void format(const code &value, format_sink &out) const
+        {
+            std::ostringstream digits;
+            if (hex) {
+                digits << std::hex;
+            }
+            digits << value.value;
+            out.append(digits.str());
+        }
+    };
+
+    template <>
+    struct formatter<identifier> {
+        void format(const identifier &value, format_sink &out) const
+        {
+            out.append("id-", 3);
+            out.append(std::to_string(value.value));
+        }
+    };
+}
+
+go_bandit([]() {
+    describe("a custom formatter", []() {
+        it("renders the value without operator<<", []() {
+            format f("{0} and {1:$}", price{1205}, price{99});
+
+            Assert::That(f.str(), Equals("12.05 and $0.99"));
+        });
+
+        it("is preferred over operator<<", []() {
+            std::ostringstream streamed;
+            streamed << identifier{42};
+
+            format f("{0}", identifier{42});
+
+            Assert::That(f.str(), Equals("id-42"));
+            Assert::That(streamed.str(), Equals("streamed"));
+        });
+
+        it("applies the specifier width and alignment", []() {
+            format f("[{0,8:$}] [{1,-8}]", price{150}, identifier{7});
+
+            Assert::That(f.str(), Equals("[   $1.50] [id-7    ]"));
+        });
+
+        it("can append to a string outside a format", []() {
+            string out = "total ";
+            format_sink sink(out);
+
+            coda::formatter<price> money;
+            money.parse('$', "");
+            money.format(price{4321}, sink);
+
+            Assert::That(out, Equals("total $43.21"));
+            Assert::That(sink.size(), Equals(out.size()));
+        });
+
+        it("pads with the fill of the specifier", []() {
+            format f("[{0,6:x}] [{1,-6}] [{2:x}]", code{171}, code{171}, code{10});
+
+            Assert::That(f.str(), Equals("[0000ab] [171   ] [0a]"));
+        });
+
+        it("can reject a specifier in its parse hook", []() {
+            format f("{0:x}");
+
+            AssertThrows(invalid_argument, f.args(price{1}));
+        });
+    });
+});
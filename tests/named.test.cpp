@@ -0,0 +1,99 @@
+#include <string>
+
+#include <bandit/bandit.h>
+#include <coda/format/format.h>
+
+using namespace bandit;
+using namespace snowhouse;
+
+using coda::format;
+
+using std::invalid_argument;
+using std::string;
+
+go_bandit([]() {
+    describe("named specifiers", []() {
+        it("binds arguments by name", []() {
+            format f("{user} logged in from {host}");
+
+            f.arg("host", "10.0.0.1").arg("user", "alice");
+
+            Assert::That(f.str(), Equals("alice logged in from 10.0.0.1"));
+        });
+
+        it("renders every repeat of a name", []() {
+            format f("{id}: {name} ({id,4:x})");
+
+            f.arg("name", "widget").arg("id", 26);
+
+            Assert::That(f.specifiers(), Equals(0));
+            Assert::That(f.str(), Equals("26: widget (001a)"));
+        });
+
+        it("binds positional arguments in order of first appearance", []() {
+            format f("{b}{a}{b}", 1, 2);
+
+            Assert::That(f.str(), Equals("121"));
+        });
+
+        it("rebinds an argument by name or index", []() {
+            format f("{level}: {message}", "info", "started");
+
+            f.arg("level", "warn").arg(1, "stopped");
+
+            Assert::That(f.str(), Equals("warn: stopped"));
+        });
+
+        it("counts only unbound arguments", []() {
+            format f("{a} {b} {a}");
+
+            Assert::That(f.specifiers(), Equals(2));
+
+            f.arg("b", 1);
+
+            Assert::That(f.specifiers(), Equals(1));
+            Assert::That(f.str(), Equals("{a} 1 {a}"));
+
+            f.reset();
+
+            Assert::That(f.specifiers(), Equals(2));
+        });
+
+        it("finds every name of a large template", []() {
+            string str;
+            for (int i = 0; i < 200; ++i) {
+                str += "{n" + std::to_string(i) + "}";
+            }
+
+            format f(str);
+            for (int i = 199; i >= 0; --i) {
+                f.arg("n" + std::to_string(i), i % 10);
+            }
+
+            string expected;
+            for (int i = 0; i < 200; ++i) {
+                expected += std::to_string(i % 10);
+            }
+
+            Assert::That(f.str(), Equals(expected));
+        });
+
+        it("throws for an unknown name", []() {
+            format f("{known}");
+
+            AssertThrows(invalid_argument, f.arg("unknown", 1));
+            AssertThrows(invalid_argument, f.arg("know", 1));
+            AssertThrows(invalid_argument, f.arg(1, 1));
+        });
+
+        it("throws for names mixed with indexes", []() {
+            AssertThrows(invalid_argument, format("{0} {name}"));
+            AssertThrows(invalid_argument, format("{name} {0}"));
+        });
+
+        it("throws for an invalid name", []() {
+            AssertThrows(invalid_argument, format("{na-me}"));
+            AssertThrows(invalid_argument, format("{name!}"));
+        });
+    });
+});
@@ -48,6 +48,11 @@ go_bandit([]() {
             AssertThrows(invalid_argument, precision_plus.args(123.123));
         });
 
+        it("treats braces inside a specifier as part of its argument", []() {
+            format f("{0:{1}");
+            Assert::That(f.specifiers(), Equals(1));
+        });
+
         it("rejects ambiguous or repeated separators", []() {
             assert_invalid_format("{0,12:f2,8}");
             assert_invalid_format("{0::f2}");
@@ -70,5 +75,104 @@ go_bandit([]() {
             assert_invalid_format("{0,128}");
             assert_invalid_format("{0,-129}");
         });
+
+        it("rejects precision that would request unbounded output", []() {
+            format f("{0:f127}", 0.5);
+            Assert::That(f.str().size(), Equals(129));
+
+            format unbounded("{0:f2000000000}");
+            AssertThrows(invalid_argument, unbounded.args(0.5));
+        });
+    });
+
+    describe("format validation", []() {
+        it("accepts valid format strings", []() {
+            Assert::That(bool(format::validate("{1} {0,-8:f2} {{literal}} {2!j}")), IsTrue());
+            Assert::That(bool(format::validate("{user} {id,4} {user}")), IsTrue());
+            Assert::That(bool(format::validate("no specifiers")), IsTrue());
+        });
+
+        it("reports the kind and offset of an error", []() {
+            auto result = format::validate("value {0");
+            Assert::That(result.error, Equals(format::parse_error::missing_close_tag));
+            Assert::That(result.offset, Equals(6));
+
+            result = format::validate("{0} {1x}");
+            Assert::That(result.error, Equals(format::parse_error::invalid_index));
+            Assert::That(result.offset, Equals(5));
+
+            result = format::validate("{0,128}");
+            Assert::That(result.error, Equals(format::parse_error::width_out_of_range));
+            Assert::That(result.offset, Equals(3));
+
+            result = format::validate("{0:f2,1x}");
+            Assert::That(result.error, Equals(format::parse_error::invalid_width));
+            Assert::That(result.offset, Equals(6));
+
+            result = format::validate("{0::f2}");
+            Assert::That(result.error, Equals(format::parse_error::invalid_specifier));
+            Assert::That(result.offset, Equals(3));
+
+            result = format::validate("{0!x}");
+            Assert::That(result.error, Equals(format::parse_error::invalid_escape));
+            Assert::That(result.offset, Equals(2));
+
+            result = format::validate("{a-b}");
+            Assert::That(result.error, Equals(format::parse_error::invalid_name));
+            Assert::That(result.offset, Equals(1));
+        });
+
+        it("reports indexes that are repeated or skip a number", []() {
+            auto result = format::validate("{0} {1} {0}");
+            Assert::That(result.error, Equals(format::parse_error::duplicate_index));
+            Assert::That(result.offset, Equals(8));
+
+            result = format::validate("{0} {3} {1}");
+            Assert::That(result.error, Equals(format::parse_error::non_contiguous_indexes));
+            Assert::That(result.offset, Equals(4));
+
+            result = format::validate("{name} {0}");
+            Assert::That(result.error, Equals(format::parse_error::mixed_specifiers));
+            Assert::That(result.offset, Equals(7));
+        });
+
+        it("includes the validation error in the exception", []() {
+            AssertThrows(invalid_argument, format("{0} {1x}"));
+            Assert::That(std::string(LastException<invalid_argument>().what()),
+                         Equals("invalid specifier index at offset 5"));
+        });
+
+        it("parses without throwing", []() {
+            format f("{0}", "unchanged");
+
+            auto result = format::try_parse("{0,3}", f);
+            Assert::That(bool(result), IsTrue());
+            f.args(7);
+            Assert::That(f.str(), Equals("  7"));
+
+            format kept("{0}", "kept");
+            result = format::try_parse("{0", kept);
+            Assert::That(result.error, Equals(format::parse_error::missing_close_tag));
+            Assert::That(kept.str(), Equals("kept"));
+        });
+
+        it("keeps the escaping and measure of the target", []() {
+            format f("{0}");
+            f.escape(format::escaping::csv).measure(format::width_unit::codepoints);
+
+            auto result = format::try_parse("{0,3}|{1}", f);
+            Assert::That(bool(result), IsTrue());
+            f.args("\xc3\xa9", "a,b");
+            Assert::That(f.str(), Equals("  \xc3\xa9|\"a,b\""));
+        });
+
+        it("describes every parse error", []() {
+            const auto last = static_cast<int>(format::parse_error::build_failed);
+
+            for (int error = 0; error <= last; ++error) {
+                const format::parse_result result{static_cast<format::parse_error>(error), 0};
+                Assert::That(std::string(result.message()) != "unknown error", IsTrue());
+            }
+        });
     });
 });
@@ -0,0 +1,49 @@
+/*!
+ * compiles a catalog of format templates, one template per line
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/catalog.h>
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <template-file> <catalog-file>" << std::endl;
+        return 2;
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::cerr << argv[1] << ": unable to open template file" << std::endl;
+        return 1;
+    }
+
+    coda::catalog_writer writer;
+
+    // the template id is the zero based line number
+    std::string line;
+    std::size_t number = 0;
+    while (std::getline(in, line)) {
+        ++number;
+        try {
+            writer.add(line);
+        } catch (const std::exception &e) {
+            std::cerr << argv[1] << ":" << number << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        writer.write(argv[2]);
+    } catch (const std::exception &e) {
+        std::cerr << argv[2] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,32 @@
+/*!
+ * renders the records of a capture file as text, one record per line
+ * @copyright ryan jennings (coda.life), 2012 under LGPL
+ */
+
+#include <coda/format/decoder.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <capture-file>" << std::endl;
+        return 2;
+    }
+
+    try {
+        coda::capture_reader reader(argv[1]);
+
+        std::string line;
+        while (reader.next(line)) {
+            std::cout << line << '\n';
+        }
+    } catch (const std::exception &e) {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}